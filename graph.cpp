@@ -2,39 +2,38 @@
 
 Graph::Graph()
 {
-    using_matrix = false;
     using_lemon = false;
     num_vertices = 0;
     num_edges = 0;
+
+    init_edge_index();
 }
 
 Graph::Graph(long n, long m)
 {
-    using_matrix = false;
     using_lemon = false;
     num_vertices = n;
     num_edges = m;
 
-    adj_list.reserve(n);
-    adj_list.insert( adj_list.begin(), n, list<long>() );
-
     s.reserve(m);
     t.reserve(m);
 
     w.reserve(m);
+
+    init_edge_index();
 }
 
 Graph::~Graph()
 {
-    adj_list.clear();
+    adj_offset.clear();
+    adj_pairs.clear();
 
     s.clear();
     t.clear();
  
     w.clear();
 
-	if (using_matrix)
-        free_index_matrix();
+    edge_index_table.clear();
 
     if (using_lemon)
     {
@@ -46,29 +45,124 @@ Graph::~Graph()
     }
 }
 
-void Graph::init_index_matrix()
+void Graph::init_adjacency_arrays()
 {
-	using_matrix = true;
+    /***
+     * Build the CSR adjacency list from the edge list, in O(n + m) time with a
+     * counting sort. Neighbours of each vertex appear in the order of the
+     * corresponding edges in the input.
+     */
 
-    index_matrix = new long*[num_vertices];
-    for (long i=0; i<num_vertices; ++i)
+    adj_offset.assign(num_vertices + 1, 0);
+    adj_pairs.assign(4 * num_edges, -1);
+
+    // 1. DEGREES, SHIFTED BY ONE POSITION
+    for (long idx = 0; idx < num_edges; ++idx)
     {
-        index_matrix[i] = new long[num_vertices];
-        for (long j=0; j<num_vertices; ++j)
-            index_matrix[i][j] = -1;
+        adj_offset[s[idx] + 1]++;
+        adj_offset[t[idx] + 1]++;
+    }
+
+    // 2. PREFIX SUMS GIVE THE FIRST POSITION OF EACH VERTEX
+    for (long u = 0; u < num_vertices; ++u)
+        adj_offset[u + 1] += adj_offset[u];
+
+    // 3. FILL (NEIGHBOUR, EDGE INDEX) PAIRS
+    vector<long> next_position(adj_offset.begin(), adj_offset.end() - 1);
+    for (long idx = 0; idx < num_edges; ++idx)
+    {
+        const long u = s[idx];
+        const long v = t[idx];
+
+        long k = next_position[u]++;
+        adj_pairs[2*k] = v;
+        adj_pairs[2*k + 1] = idx;
+
+        k = next_position[v]++;
+        adj_pairs[2*k] = u;
+        adj_pairs[2*k + 1] = idx;
     }
 }
 
-void Graph::free_index_matrix()
+void Graph::init_edge_index()
 {
-    for (long i = 0; i<num_vertices; ++i)
-        delete[] index_matrix[i];
+    /***
+     * Allocate an empty hash table for (at least) num_edges entries, keeping
+     * the load factor at most 1/2 so that linear probing stays short. Memory
+     * is in O(m), regardless of the number of vertices.
+     */
 
-    delete[] index_matrix;
+    unsigned long capacity = 2;
+    while (capacity < 2 * (unsigned long) num_edges)
+        capacity *= 2;
+
+    set_edge_index_slots(capacity);
+    edge_index_table.assign(2 * capacity, -1);
+}
+
+void Graph::set_edge_index_slots(unsigned long capacity)
+{
+    /// mask (for probing) and shift (for hashing) of a power of two capacity
+
+    edge_index_mask = capacity - 1;
+
+    edge_index_shift = 64;
+    for (unsigned long slots = capacity; slots > 1; slots /= 2)
+        --edge_index_shift;
+}
+
+bool Graph::add_edge_index(long u, long v, long idx)
+{
+    /***
+     * Store idx as the index of edge uv. Returns false (keeping the table
+     * unchanged) if uv was already stored, i.e. in case of a repeated edge.
+     */
+
+    const long key = (u < v) ? u*num_vertices + v : v*num_vertices + u;
+
+    unsigned long slot = edge_index_slot(key);
+    while (edge_index_table[2*slot] >= 0)
+    {
+        if (edge_index_table[2*slot] == key)
+            return false;
+
+        slot = (slot + 1) & edge_index_mask;  // linear probing
+    }
+
+    edge_index_table[2*slot] = key;
+    edge_index_table[2*slot + 1] = idx;
+
+    return true;
+}
+
+ListGraph *Graph::get_lemon_graph()
+{
+    if (!using_lemon)
+        init_lemon();
+
+    return lemon_graph;
+}
+
+ListGraph::EdgeMap<double> *Graph::get_lemon_weight()
+{
+    if (!using_lemon)
+        init_lemon();
+
+    return lemon_weight;
+}
+
+ListGraph::EdgeMap<long> *Graph::get_lemon_edges_inverted_index()
+{
+    if (!using_lemon)
+        init_lemon();
+
+    return lemon_edges_inverted_index;
 }
 
 void Graph::init_lemon()
 {
+    /// LEMON mirror of this graph, built lazily by the get_lemon_* methods
+
     using_lemon = true;
 
     lemon_graph = new ListGraph();
@@ -99,6 +193,175 @@ void Graph::init_lemon()
 
 }
 
+void Graph::build_smart_graph(SmartGraph &g, long extra_vertices)
+{
+    /***
+     * Populate an empty LEMON SmartGraph (array-backed, with consecutive ids)
+     * with the vertices and edges of this graph, plus the given number of
+     * extra (isolated) vertices. The id of each node and edge in g coincides
+     * with the index in this object, so callers may simply use
+     * g.nodeFromId(u) and g.edgeFromId(idx), and the extra vertices get ids
+     * num_vertices, num_vertices+1, ...
+     */
+
+    g.clear();
+    g.reserveNode(num_vertices + extra_vertices);
+    g.reserveEdge(num_edges);
+
+    for (long i=0; i < num_vertices + extra_vertices; ++i)
+        g.addNode();
+
+    for (long idx=0; idx < num_edges; ++idx)
+        g.addEdge(g.nodeFromId(s[idx]), g.nodeFromId(t[idx]));
+}
+
+long Graph::connected_components(vector<long> &component) const
+{
+    /***
+     * Tag each vertex with the index of its connected component (in order of
+     * smallest vertex), returning the number of components. Runs in O(n + m),
+     * with an explicit stack instead of recursion.
+     */
+
+    component.assign(num_vertices, -1);
+    long num_components = 0;
+    vector<long> stack;
+
+    for (long root = 0; root < num_vertices; ++root)
+    {
+        if (component[root] >= 0)
+            continue;
+
+        component[root] = num_components;
+        stack.push_back(root);
+
+        while (!stack.empty())
+        {
+            long u = stack.back();
+            stack.pop_back();
+
+            for (long k = adj_offset[u]; k < adj_offset[u+1]; ++k)
+            {
+                long v = adj_pairs[2*k];
+                if (component[v] < 0)
+                {
+                    component[v] = num_components;
+                    stack.push_back(v);
+                }
+            }
+        }
+
+        ++num_components;
+    }
+
+    return num_components;
+}
+
+bool Graph::is_connected_matching(const vector<bool> &edge_in_solution,
+                                  bool verbose)
+{
+    /***
+     * Check that the given edge subset (indicator vector over edge indices) is
+     * a matching, and that the vertices it covers induce a connected subgraph.
+     * Runs in O(n + m), with an explicit stack instead of recursion. Error
+     * messages are only printed if verbose is set.
+     */
+
+    // 1. MATCHING: EACH VERTEX COVERED AT MOST ONCE
+    vector<bool> covered = vector<bool>(num_vertices, false);
+
+    for (long e = 0; e < num_edges; ++e)
+    {
+        if (edge_in_solution[e])
+        {
+            if (covered[s[e]] || covered[t[e]])
+            {
+                if (verbose)
+                    cout << endl << "ERROR (MATCHING): some vertex has degree above 1" << endl;
+                return false;
+            }
+
+            covered[s[e]] = true;
+            covered[t[e]] = true;
+        }
+    }
+
+    // 2. CONNECTIVITY: COUNT COMPONENTS OF THE SUBGRAPH INDUCED BY COVERED VERTICES
+    long num_components = 0;
+    vector<bool> seen = vector<bool>(num_vertices, false);
+    vector<long> stack;
+
+    for (long root = 0; root < num_vertices; ++root)
+    {
+        // should enter only once, from the first covered vertex
+        if (!covered[root] || seen[root])
+            continue;
+
+        ++num_components;
+        seen[root] = true;
+        stack.push_back(root);
+
+        while (!stack.empty())
+        {
+            long u = stack.back();
+            stack.pop_back();
+
+            for (long k = adj_offset[u]; k < adj_offset[u+1]; ++k)
+            {
+                long v = adj_pairs[2*k];
+                if (covered[v] && !seen[v])
+                {
+                    seen[v] = true;
+                    stack.push_back(v);
+                }
+            }
+        }
+    }
+
+    if (num_components > 1)
+    {
+        if (verbose)
+            cout << endl
+                 << "ERROR (CONNECTIVITY): subgraph induced by y is not connected ("
+                 << num_components << " components)" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+double Graph::edge_subset_weight(const vector<bool> &edge_in_solution) const
+{
+    double weight = 0;
+
+    for (long e = 0; e < num_edges; ++e)
+        if (edge_in_solution[e])
+            weight += w[e];
+
+    return weight;
+}
+
+double Graph::max_weight_matching(vector<bool> &edge_in_matching)
+{
+    /***
+     * Maximum weight matching (disregarding connectivity), computed with the
+     * LEMON implementation of Edmonds' algorithm on the LEMON mirror of this
+     * graph. Its weight is an upper bound on that of any connected matching.
+     */
+
+    ListGraph *g = get_lemon_graph();
+    MaxWeightedMatching< ListGraph, ListGraph::EdgeMap<double> >
+        matching(*g, *get_lemon_weight());
+    matching.run();
+
+    edge_in_matching = vector<bool>(num_edges, false);
+    for (long idx = 0; idx < num_edges; ++idx)
+        if (matching.matching(lemon_edges[idx]))
+            edge_in_matching[idx] = true;
+
+    return edge_subset_weight(edge_in_matching);
+}
+
 bool Graph::lemon_test_adj(ListGraph &g,
                            ListGraph::Node &x,
                            ListGraph::Node &y)
@@ -6,6 +6,8 @@
 #include <limits>
 
 #include <lemon/list_graph.h>
+#include <lemon/smart_graph.h>
+#include <lemon/matching.h>
 #include <lemon/time_measure.h>
 #include <lemon/core.h>
 
@@ -17,10 +19,17 @@ using namespace lemon;
  * 
  * Module containing different data structures representing the same graph:
  * - an edge list, with terminals of each edge stored in vectors s and t
- * - an adjacency matrix storing the corresponding index (or -1 for non-edges)
+ * - an adjacency list in compressed sparse row format, storing each neighbour
+ * together with the index of the corresponding edge
+ * - an open-addressing hash table mapping each vertex pair to the index of the
+ * corresponding edge (or -1 for non-edges), taking O(m) memory instead of the
+ * O(n^2) of an adjacency matrix
  * - an adjacency list from the LEMON (Library for Efficient Modeling and 
  * Optimization in Networks), so as to use the highly efficient implementations
- * of algorithms they offer
+ * of algorithms they offer; this one is only built on first access, as most
+ * executions never use it
+ * - on request, an array-backed LEMON SmartGraph built from the edge list, for
+ * separation procedures that run LEMON algorithms on (extensions of) the graph
  * 
  * Some classes are declared friends to avoid cumbersome get/set calls.
  * 
@@ -34,34 +43,62 @@ public:
     Graph(long, long);
     virtual ~Graph();
 
-    void init_index_matrix();
-    void free_index_matrix();
+    void init_adjacency_arrays();
 
-    void init_lemon();
+    void init_edge_index();
+    bool add_edge_index(long, long, long);
+    long edge_index(long, long) const;
+
+    ListGraph *get_lemon_graph();
+    ListGraph::EdgeMap<double> *get_lemon_weight();
+    ListGraph::EdgeMap<long> *get_lemon_edges_inverted_index();
+
+    void build_smart_graph(SmartGraph &, long);
+
+    long connected_components(vector<long> &) const;
+    bool is_connected_matching(const vector<bool> &, bool);
+    double edge_subset_weight(const vector<bool> &) const;
+
+    double max_weight_matching(vector<bool> &);
 
 private:
     friend class IO;
     friend class CompactWCMModel;
     friend class WCMModel;
     friend class WCMCutGenerator;
+    friend class WCMDecomposition;
+    friend class WCMReduction;
+    friend class WCMHeuristic;
+    friend class WCMMetaheuristic;
+    friend class WCMLNS;
 
     long num_vertices;
     long num_edges;
 
     vector<double> w;    // edge weights
 
-    // adjacency list
-    vector< list<long> > adj_list;
+    // adjacency list in compressed sparse row (CSR) format: the neighbours of
+    // vertex u are stored in positions [adj_offset[u], adj_offset[u+1]), each
+    // one as an interleaved pair (neighbour, edge index) in adj_pairs, i.e.
+    // the k-th entry is given by adj_pairs[2*k] and adj_pairs[2*k + 1]
+    vector<long> adj_offset;
+    vector<long> adj_pairs;
 
     // edge list
     vector<long> s;      // terminal vertex 1
     vector<long> t;      // terminal vertex 2
 
-    // adjacency matrix storing edge indexes
-    bool using_matrix;
-    long **index_matrix;
+    // hash table storing edge indexes: slot i holds a key (packed vertex pair,
+    // or -1 if empty) at position 2i and the edge index at position 2i+1
+    vector<long> edge_index_table;
+    unsigned long edge_index_mask;
+    unsigned edge_index_shift;    // 64 - log2(number of slots)
+    void set_edge_index_slots(unsigned long);
+    unsigned long inline edge_index_slot(long) const;
 
     // LEMON adjacency list: http://lemon.cs.elte.hu/pub/doc/1.3/a00237.html
+    // NB! Use the get_lemon_* methods above, which call init_lemon() if needed
+    void init_lemon();
     bool using_lemon;
     ListGraph *lemon_graph;
     vector<ListGraph::Node> lemon_vertices;
@@ -75,4 +112,31 @@ private:
                                                 ListGraph::Node &);
 };
 
+/// hash table lookups are on the critical path of every separation routine
+
+unsigned long inline Graph::edge_index_slot(long key) const
+{
+    // fibonacci hashing: multiplicative constant 2^64 / golden ratio, taking
+    // the high bits of the product (the low ones only permute key mod slots)
+    return ((unsigned long) key * 11400714819323198485ul) >> edge_index_shift;
+}
+
+long inline Graph::edge_index(long u, long v) const
+{
+    /// index of edge uv, or -1 if u and v are not adjacent
+
+    const long key = (u < v) ? u*num_vertices + v : v*num_vertices + u;
+
+    unsigned long slot = edge_index_slot(key);
+    while (edge_index_table[2*slot] >= 0)
+    {
+        if (edge_index_table[2*slot] == key)
+            return edge_index_table[2*slot + 1];
+
+        slot = (slot + 1) & edge_index_mask;  // linear probing
+    }
+
+    return -1;
+}
+
 #endif
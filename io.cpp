@@ -4,6 +4,9 @@ IO::IO()
 {
     summary_info = stringstream();
 
+    this->parsing_runtime = -1;
+    this->parsing_throughput = -1;
+
     // only for consistency (while an input parsing method is not called)
     this->graph = new Graph();
 }
@@ -13,89 +16,232 @@ IO::~IO()
     delete graph;
 }
 
-bool IO::parse_gcc_file(string filename)
+///////////////////////////////////////////////////////////////////////////////
+
+/// memory-mapped input files, tokenized in a single forward pass
+
+bool inline map_input_file(string filename,
+                           const char *&begin,
+                           const char *&end,
+                           size_t &size)
 {
-    /// Simple input with a weight for each vertex (subgraphs do not matter)
+    /// map the whole file read-only; returns false if it cannot be opened
 
-    long num_vertices, num_edges;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
 
-    ifstream input_fh(filename);
-    
-    if (input_fh.is_open())
+    struct stat file_info;
+    if (fstat(fd, &file_info) < 0)
     {
-        string line;
-        
-        // skip comment lines
-        do
-        {
-            getline(input_fh, line);
-        }
-        while(line.find("#") != string::npos);   // there is a trail
+        close(fd);
+        return false;
+    }
 
-        instance_id.assign(line);
+    size = file_info.st_size;
+    if (size == 0)
+    {
+        close(fd);
+        begin = end = NULL;
+        return true;
+    }
 
-        // trimmed instance id: contents after last slash and before last dot
-        size_t dot_pos = filename.find_last_of(".");
-        size_t last_slash_pos = filename.find_last_of("/\\");
-        instance_id_trimmed = filename.substr(last_slash_pos+1,
-                                              dot_pos-1 - last_slash_pos);
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);   // the mapping remains valid after closing the descriptor
 
-        // 2 lines for number of vertices and edges
-        input_fh >> num_vertices;
-        input_fh >> num_edges;
+    if (data == MAP_FAILED)
+        return false;
 
-        // initialize graph (own structures only; lemon object at the end)
-        delete graph;
-        this->graph = new Graph(num_vertices,num_edges);
-        this->graph->init_index_matrix();
+    madvise(data, size, MADV_SEQUENTIAL);
 
-        // m lines for edges
-        this->only_nonpositive_weights = true;
-        for (long line_idx = 0; line_idx < num_edges; ++line_idx)
-        {
-            long i, j;
-            double w;
-            
-            input_fh >> i;
-            graph->s.push_back(i);
+    begin = (const char*) data;
+    end = begin + size;
+    return true;
+}
 
-            input_fh >> j;
-            graph->t.push_back(j);
+void inline unmap_input_file(const char *begin, size_t size)
+{
+    if (begin != NULL)
+        munmap((void*) begin, size);
+}
 
-            input_fh >> w;
-            graph->w.push_back(w);
-            
-            graph->adj_list[i].push_back(j);
-            graph->adj_list[j].push_back(i);
-            
-            // should never happen
-            if (graph->index_matrix[i][j] >= 0 ||
-                graph->index_matrix[j][i] >= 0 )
-            {
-                cerr << "ERROR: repeated edge in input file line "
-                     << line_idx << endl << endl;
-                return false;
-            }
-            
-            // store index of current edge
-            graph->index_matrix[i][j] = line_idx;
-            graph->index_matrix[j][i] = line_idx;
+bool inline is_blank(char c)
+{
+    return (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+}
 
-            // keeping track if all edges have <= 0 weight
-            if (w > 0 && only_nonpositive_weights)
-                only_nonpositive_weights = false;
-        }
+bool inline next_token(const char *&pos,
+                       const char *end,
+                       const char *&token,
+                       size_t &len)
+{
+    /// advance pos past the next whitespace-delimited token (false at eof)
+
+    while (pos < end && is_blank(*pos))
+        ++pos;
+
+    if (pos == end)
+        return false;
+
+    token = pos;
+    while (pos < end && !is_blank(*pos))
+        ++pos;
+
+    len = pos - token;
+    return true;
+}
+
+bool inline token_is(const char *token, size_t len, const char *word)
+{
+    return (len == strlen(word) && strncmp(token, word, len) == 0);
+}
+
+void inline skip_line(const char *&pos, const char *end)
+{
+    while (pos < end && *pos != '\n')
+        ++pos;
+
+    if (pos < end)
+        ++pos;
+}
+
+template<typename T>
+bool inline next_number(const char *&pos, const char *end, T &value)
+{
+    /// parse the next token as a number, without copying it anywhere
+
+    const char *token;
+    size_t len;
+    if (!next_token(pos, end, token, len))
+        return false;
 
-        input_fh.close();
+    // std::from_chars does not accept an explicit plus sign
+    if (*token == '+' && len > 1)
+    {
+        ++token;
+        --len;
     }
-    else
+
+    from_chars_result result = from_chars(token, token + len, value);
+    return (result.ec == errc() && result.ptr == token + len);
+}
+
+double inline report_parsing_throughput(size_t size, double time)
+{
+    /// print (and return) the parsing throughput in MB/s
+
+    double megabytes = (double) size / (1024.0 * 1024.0);
+    double throughput = (time > 0) ? megabytes / time : -1;
+
+    cout << "Parsed " << fixed << setprecision(2) << megabytes << " MB in "
+         << setprecision(4) << time << " s";
+    if (throughput > 0)
+        cout << " (" << setprecision(2) << throughput << " MB/s)";
+    cout << endl;
+
+    cout.unsetf(ios_base::floatfield);
+    cout << setprecision(6);
+
+    return throughput;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool IO::parse_gcc_file(string filename)
+{
+    /// Simple input with a weight for each vertex (subgraphs do not matter)
+
+    Timer parsing_clock;
+
+    const char *begin, *end;
+    size_t size;
+    if (!map_input_file(filename, begin, end, size))
     {
         cerr << "ERROR: could not open file (might not exist)." << endl;
         return false;
     }
 
-    // lemon data structure initialization
-    graph->init_lemon();
+    const char *pos = begin;
+
+    // skip comment lines; the first other line is the instance id
+    const char *line_begin = pos;
+    const char *line_end = pos;
+    do
+    {
+        line_begin = pos;
+        skip_line(pos, end);
+        line_end = pos;
+        while (line_end > line_begin && is_blank(*(line_end-1)))
+            --line_end;
+    }
+    while (pos < end && memchr(line_begin, '#', line_end - line_begin) != NULL);
+
+    instance_id.assign(line_begin, line_end - line_begin);
+
+    // trimmed instance id: contents after last slash and before last dot
+    size_t dot_pos = filename.find_last_of(".");
+    size_t last_slash_pos = filename.find_last_of("/\\");
+    instance_id_trimmed = filename.substr(last_slash_pos+1,
+                                          dot_pos-1 - last_slash_pos);
+
+    // 2 lines for number of vertices and edges
+    long num_vertices, num_edges;
+    if (!next_number(pos, end, num_vertices) ||
+        !next_number(pos, end, num_edges) ||
+        num_vertices < 0 || num_edges < 0)
+    {
+        cerr << "ERROR: could not read the number of vertices and edges"
+             << endl << endl;
+        unmap_input_file(begin, size);
+        return false;
+    }
+
+    // initialize graph (own structures only; adjacency arrays at the end)
+    delete graph;
+    this->graph = new Graph(num_vertices,num_edges);
+
+    // m lines for edges
+    this->only_nonpositive_weights = true;
+    for (long line_idx = 0; line_idx < num_edges; ++line_idx)
+    {
+        long i, j;
+        double w;
+
+        if (!next_number(pos, end, i) || !next_number(pos, end, j) ||
+            !next_number(pos, end, w) ||
+            i < 0 || j < 0 || i >= num_vertices || j >= num_vertices)
+        {
+            cerr << "ERROR: invalid edge in input file line "
+                 << line_idx << endl << endl;
+            unmap_input_file(begin, size);
+            return false;
+        }
+
+        graph->s.push_back(i);
+        graph->t.push_back(j);
+        graph->w.push_back(w);
+
+        // store index of current edge (repeated edges should never happen)
+        if (!graph->add_edge_index(i, j, line_idx))
+        {
+            cerr << "ERROR: repeated edge in input file line "
+                 << line_idx << endl << endl;
+            unmap_input_file(begin, size);
+            return false;
+        }
+
+        // keeping track if all edges have <= 0 weight
+        if (w > 0 && only_nonpositive_weights)
+            only_nonpositive_weights = false;
+    }
+
+    unmap_input_file(begin, size);
+
+    // adjacency arrays (the lemon data structure is only built if needed)
+    graph->init_adjacency_arrays();
+
+    this->parsing_runtime = parsing_clock.realTime();
+    this->parsing_throughput = report_parsing_throughput(size, parsing_runtime);
 
     return true;
 }
@@ -107,58 +253,97 @@ bool IO::parse_stp_file(string filename, bool edge_weights_given)
      * If edge_weights_given is set to true, edge weights are expected in each
      * edge line. Otherwise, we add the weights of the endpoint vertices of each
      * edge to determine its weight.
+     *
+     * The file is memory-mapped and tokenized in a single forward pass, with
+     * vertex weights from the terminals section stored as they are read.
      */
 
+    Timer parsing_clock;
+
     // instance id from file name: what's after last slash and before last dot
     size_t dot_pos = filename.find_last_of(".");
     size_t last_slash_pos = filename.find_last_of("/\\");
     instance_id = filename.substr(last_slash_pos+1, dot_pos-1 - last_slash_pos);
     instance_id_trimmed = instance_id;
 
-    long num_vertices, num_edges;
+    const char *begin, *end;
+    size_t size;
+    if (!map_input_file(filename, begin, end, size))
+    {
+        cerr << "ERROR: could not open file (might not exist)." << endl;
+        return false;
+    }
+
+    long num_vertices = -1;
+    long num_edges = -1;
+    long edges_read = 0;
+    vector<double> vertex_weights;
+
+    enum { NO_SECTION, GRAPH_SECTION, TERMINALS_SECTION, OTHER_SECTION }
+        section = NO_SECTION;
+
+    this->only_nonpositive_weights = true;
+
+    const char *pos = begin;
+    const char *token;
+    size_t len;
+    bool valid = true;
 
-    ifstream input_fh(filename);
-    
-    if (input_fh.is_open())
+    while (valid && next_token(pos, end, token, len))
     {
-        string line, word;
-        
-        // 1. SKIP IDENTIFICATION LINE AND COMMENT SECTION
-        do
+        if (token_is(token, len, "SECTION"))
         {
-            getline(input_fh, line);
+            // 1. SECTION HEADERS: ONLY GRAPH AND TERMINALS MATTER
+            valid = next_token(pos, end, token, len);
+            if (valid && token_is(token, len, "Graph"))
+                section = GRAPH_SECTION;
+            else if (valid && token_is(token, len, "Terminals"))
+                section = TERMINALS_SECTION;
+            else
+                section = OTHER_SECTION;
+
+            skip_line(pos, end);
+        }
+        else if (token_is(token, len, "END"))
+        {
+            section = NO_SECTION;
+            skip_line(pos, end);
         }
-        while(line.find("SECTION Graph") == string::npos);
-
-        // 2. TWO LINES FOR NUMBER OF VERTICES AND EDGES
-        input_fh >> word;          // e.g. "Nodes 2853"
-        input_fh >> num_vertices;
-        input_fh >> word;          // e.g. "Edges 3335"
-        input_fh >> num_edges;
-
-        // initialize graph (own structures only; lemon object at the end)
-        delete graph;
-        this->graph = new Graph(num_vertices,num_edges);
-        this->graph->init_index_matrix();
-
-        // 3. m LINES FOR EDGES
-        this->only_nonpositive_weights = true;
-        for (long line_idx = 0; line_idx < num_edges; ++line_idx)
+        else if (token_is(token, len, "EOF"))
+            break;
+        else if (section == GRAPH_SECTION && token_is(token, len, "Nodes"))
         {
-            // must skip a word (the edge line marker "E"): e.g. "E 1 2" 
-            input_fh >> word;
+            // 2. NUMBER OF VERTICES AND EDGES, e.g. "Nodes 2853"
+            valid = next_number(pos, end, num_vertices) && num_vertices >= 0;
 
+            if (valid)
+                vertex_weights.assign(num_vertices, 0.0);
+        }
+        else if (section == GRAPH_SECTION && token_is(token, len, "Edges"))
+        {
+            // e.g. "Edges 3335"
+            valid = next_number(pos, end, num_edges) && num_edges >= 0 &&
+                    num_vertices >= 0;
+
+            if (valid)
+            {
+                delete graph;
+                this->graph = new Graph(num_vertices,num_edges);
+            }
+        }
+        else if (section == GRAPH_SECTION && token_is(token, len, "E"))
+        {
+            // 3. m LINES FOR EDGES, e.g. "E 1 2" or "E 1 2 -0.5"
             // NB! in this format, the vertices are labeled in [1, n]
             long i, j;
-            input_fh >> i;
-            input_fh >> j;
-            --i;
-            --j;
+            valid = (num_edges >= 0 && edges_read < num_edges) &&
+                    next_number(pos, end, i) && next_number(pos, end, j) &&
+                    i >= 1 && j >= 1 && i <= num_vertices && j <= num_vertices;
 
-            if (edge_weights_given)
+            if (valid && edge_weights_given)
             {
                 double weight;
-                input_fh >> weight;
+                valid = next_number(pos, end, weight);
                 graph->w.push_back(weight);
 
                 // keeping track if all edges have <= 0 weight
@@ -166,98 +351,559 @@ bool IO::parse_stp_file(string filename, bool edge_weights_given)
                     only_nonpositive_weights = false;
             }
 
+            if (!valid)
+            {
+                cerr << "ERROR: invalid edge in input file line "
+                     << edges_read << endl << endl;
+                unmap_input_file(begin, size);
+                return false;
+            }
+
+            --i;
+            --j;
             graph->s.push_back(i);
             graph->t.push_back(j);
-            
-            graph->adj_list[i].push_back(j);
-            graph->adj_list[j].push_back(i);
-            
-            // should never happen
-            if (graph->index_matrix[i][j] >= 0 ||
-                graph->index_matrix[j][i] >= 0 )
+
+            // store index of current edge (repeated edges should never happen)
+            if (!graph->add_edge_index(i, j, edges_read))
             {
                 cerr << "ERROR: repeated edge in input file line "
-                     << line_idx << endl << endl;
+                     << edges_read << endl << endl;
+                unmap_input_file(begin, size);
                 return false;
             }
-            
-            // store index of current edge
-            graph->index_matrix[i][j] = line_idx;
-            graph->index_matrix[j][i] = line_idx;
+
+            ++edges_read;
         }
+        else if (section == TERMINALS_SECTION && token_is(token, len, "T"))
+        {
+            // 4. VERTEX WEIGHTS (NOT GIVEN IN ORDER...!) e.g. "T 2064 -10.58"
+            // NB! Remember: in this format, the vertices are labeled in [1, n]
+            long u;
+            double weight;
+            valid = next_number(pos, end, u) && next_number(pos, end, weight) &&
+                    u >= 1 && u <= num_vertices;
 
-        if (!edge_weights_given)
+            if (valid)
+                vertex_weights[u-1] = weight;
+        }
+        else
         {
-            /**
-             * 4. ADVANCE TO TERMINALS SECTION: USING VERTEX WEIGHT TO DETERMINE 
-             * EDGE WEIGHTS. EACH EDGE IS ASSIGNED A WEIGHT EQUAL TO THE SUM OF THE
-             * WEIGHTS OF ITS TERMINALS.
-             */
-            do
-            {
-                getline(input_fh, line);
-            }
-            while(line.find("SECTION Terminals") == string::npos);
+            // identification line, comments, "Terminals k", etc.
+            skip_line(pos, end);
+        }
+    }
 
-            // skip line for number of terminals e.g. "Terminals 2853"
-            getline(input_fh, line);
+    unmap_input_file(begin, size);
 
-            // n lines for vertex weights (not given in order...!)
-            vector<double> tmp_vertex_weights = vector<double>(num_vertices, 0.0);
-            for (long line_idx = 0; line_idx < num_vertices; ++line_idx)
-            {
-                // must skip a word (the terminal line marker "T"): e.g. "T 2064 -10.5885201522015"
-                input_fh >> word;
+    if (!valid || num_edges < 0 || edges_read != num_edges)
+    {
+        cerr << "ERROR: malformed input file (" << edges_read << " of "
+             << num_edges << " edges read)" << endl << endl;
+        return false;
+    }
 
-                // NB! Remember: in this format, the vertices are labeled in [1, n]
-                long u;
-                input_fh >> u;
-                --u;
+    if (!edge_weights_given)
+    {
+        /**
+         * 5. USING VERTEX WEIGHTS TO DETERMINE EDGE WEIGHTS: EACH EDGE IS
+         * ASSIGNED A WEIGHT EQUAL TO THE SUM OF THE WEIGHTS OF ITS TERMINALS.
+         */
+        for (long e = 0; e < num_edges; ++e)
+        {
+            long v1 = graph->s[e];
+            long v2 = graph->t[e];
 
-                double w;
-                input_fh >> w;
-                tmp_vertex_weights.at(u) = w;
-            }
+            double w = vertex_weights[v1] + vertex_weights[v2];
 
-            for (long e = 0; e < num_edges; ++e)
-            {
-                long v1 = graph->s.at(e);
-                long v2 = graph->t.at(e);
-                
-                double w = tmp_vertex_weights.at(v1) + tmp_vertex_weights.at(v2);
-                
-                graph->w.push_back(w);
+            graph->w.push_back(w);
 
-                // keeping track if all edges have <= 0 weight
-                if (w > 0 && only_nonpositive_weights)
-                    only_nonpositive_weights = false;
-            }
+            // keeping track if all edges have <= 0 weight
+            if (w > 0 && only_nonpositive_weights)
+                only_nonpositive_weights = false;
         }
+    }
+
+    #ifdef DEBUG
+        cout << endl << "### STP instance parsed";
+        cout << endl << "  id = " << instance_id_trimmed
+             << endl << "  n  = " << num_vertices
+             << endl << "  m  = " << num_edges
+             << endl << "  edge 0  = {" << graph->s.at(0) << ", " << graph->t.at(0) << "}"
+             << endl << "  edge " << graph->s.size() << "  = {" << graph->s.back() << ", " << graph->t.back() << "}"
+             << endl << "  weight of edge 0 = " << graph->w.at(0)
+             << endl << "  weight of edge " << graph->w.size() << " = " << graph->w.back()
+             << endl << endl;
+    #endif
+
+    // adjacency arrays (the lemon data structure is only built if needed)
+    graph->init_adjacency_arrays();
+
+    this->parsing_runtime = parsing_clock.realTime();
+    this->parsing_throughput = report_parsing_throughput(size, parsing_runtime);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/***
+ * Binary pre-parsed instance cache (.wcmb files). Layout, in native byte order:
+ * - header (struct below), including a stamp (size and modification time) of
+ *   the text file it was generated from, and a checksum of the payload
+ * - payload, in 8-byte words: instance id (zero-padded), then arrays s, t, w,
+ *   adj_offset, adj_pairs and the edge index hash table, exactly as in Graph
+ */
+
+const char WCMB_MAGIC[4] = {'W', 'C', 'M', 'B'};
+const uint32_t WCMB_VERSION = 2;    // 2: hash slots from the high bits
+
+struct WCMBHeader
+{
+    char magic[4];
+    uint32_t version;
+    int64_t num_vertices;
+    int64_t num_edges;
+    int64_t edge_weights_given;
+    int64_t only_nonpositive_weights;
+    int64_t source_size;
+    int64_t source_mtime;      // nanoseconds
+    int64_t instance_id_length;
+    int64_t edge_index_table_size;
+    uint64_t checksum;
+};
+
+uint64_t inline wcmb_checksum(const char *data, size_t len)
+{
+    /// FNV-1a over 64-bit words (len is always a multiple of 8 here)
+
+    uint64_t hash = 14695981039346656037ull;
+    const uint64_t *words = (const uint64_t*) data;
+    const size_t num_words = len / 8;
+
+    for (size_t i = 0; i < num_words; ++i)
+        hash = (hash ^ words[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+bool inline source_file_stamp(string filename, int64_t &size, int64_t &mtime)
+{
+    struct stat file_info;
+    if (stat(filename.c_str(), &file_info) < 0)
+        return false;
+
+    size = file_info.st_size;
+    mtime = (int64_t) file_info.st_mtim.tv_sec * 1000000000 +
+            file_info.st_mtim.tv_nsec;
+    return true;
+}
+
+string IO::binary_cache_path(string filename)
+{
+    /// e.g. input/ex3.stp -> input/ex3.wcmb
+
+    size_t dot_pos = filename.find_last_of(".");
+    size_t last_slash_pos = filename.find_last_of("/\\");
+
+    if (dot_pos == string::npos ||
+        (last_slash_pos != string::npos && dot_pos < last_slash_pos))
+        return filename + ".wcmb";
 
-        #ifdef DEBUG
-            cout << endl << "### STP instance parsed";
-            cout << endl << "  id = " << instance_id_trimmed
-                 << endl << "  n  = " << num_vertices
-                 << endl << "  m  = " << num_edges
-                 << endl << "  edge 0  = {" << graph->s.at(0) << ", " << graph->t.at(0) << "}"
-                 << endl << "  edge " << graph->s.size() << "  = {" << graph->s.back() << ", " << graph->t.back() << "}"
-                 //<< endl << "  tmp_weight of v0 = " << tmp_vertex_weights.at(0)
-                 //<< endl << "  tmp_weight of v" << num_vertices-1 << " = " << tmp_vertex_weights.at(num_vertices-1)
-                 << endl << "  weight of edge 0 = " << graph->w.at(0)
-                 << endl << "  weight of edge " << graph->w.size() << " = " << graph->w.back()
-                 << endl << endl;
-        #endif
-
-        input_fh.close();
+    return filename.substr(0, dot_pos) + ".wcmb";
+}
+
+bool IO::parse_input_file(string filename, bool edge_weights_given, bool use_cache)
+{
+    /***
+     * Parse an instance in .gcc or .stp format (chosen by the file extension).
+     * If use_cache is set, a binary pre-parsed copy next to the input file is
+     * loaded instead whenever it is up to date; otherwise, the text file is
+     * parsed and the binary copy is (re)written for subsequent runs.
+     */
+
+    string cache_path = binary_cache_path(filename);
+
+    if (use_cache && load_binary_cache(cache_path, filename, edge_weights_given))
+        return true;
+
+    string file_extension = filename.substr(filename.find_last_of(".")+1);
+
+    bool successful_parsing = (file_extension.compare("gcc") == 0) ?
+                              parse_gcc_file(filename) :
+                              parse_stp_file(filename, edge_weights_given);
+
+    if (successful_parsing && use_cache)
+        write_binary_cache(cache_path, filename, edge_weights_given);
+
+    return successful_parsing;
+}
+
+bool IO::write_binary_cache(string cache_path,
+                            string source_path,
+                            bool edge_weights_given)
+{
+    /***
+     * Dump the parsed instance in binary format. Written to a temporary file
+     * and then renamed, so that concurrent runs never see a partial cache.
+     */
+
+    WCMBHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WCMB_MAGIC, 4);
+    header.version = WCMB_VERSION;
+    header.num_vertices = graph->num_vertices;
+    header.num_edges = graph->num_edges;
+    header.edge_weights_given = edge_weights_given;
+    header.only_nonpositive_weights = only_nonpositive_weights;
+    header.instance_id_length = instance_id.size();
+    header.edge_index_table_size = graph->edge_index_table.size();
+
+    if (!source_file_stamp(source_path, header.source_size, header.source_mtime))
+        return false;
+
+    // payload assembled in memory first, to compute its checksum
+    const size_t id_words = (instance_id.size() + 7) / 8;
+    const size_t m = graph->num_edges;
+    const size_t n = graph->num_vertices;
+    const size_t payload_words = id_words + 3*m + (n+1) + 4*m
+                               + graph->edge_index_table.size();
+
+    vector<uint64_t> payload(payload_words, 0);
+    char *pos = (char*) payload.data();
+
+    memcpy(pos, instance_id.data(), instance_id.size());
+    pos += 8 * id_words;
+    memcpy(pos, graph->s.data(), 8 * m);
+    pos += 8 * m;
+    memcpy(pos, graph->t.data(), 8 * m);
+    pos += 8 * m;
+    memcpy(pos, graph->w.data(), 8 * m);
+    pos += 8 * m;
+    memcpy(pos, graph->adj_offset.data(), 8 * (n+1));
+    pos += 8 * (n+1);
+    memcpy(pos, graph->adj_pairs.data(), 8 * 4 * m);
+    pos += 8 * 4 * m;
+    memcpy(pos, graph->edge_index_table.data(), 8 * graph->edge_index_table.size());
+
+    header.checksum = wcmb_checksum((const char*) payload.data(), 8 * payload_words);
+
+    stringstream tmp_path;
+    tmp_path << cache_path << ".tmp." << getpid();
+
+    ofstream cache_fh(tmp_path.str(), ios::binary | ios::trunc);
+    if (!cache_fh.is_open())
+    {
+        cout << "WARNING: unable to write binary cache " << cache_path << endl;
+        return false;
     }
-    else
+
+    cache_fh.write((const char*) &header, sizeof(header));
+    cache_fh.write((const char*) payload.data(), 8 * payload_words);
+    cache_fh.close();
+
+    if (!cache_fh || rename(tmp_path.str().c_str(), cache_path.c_str()) != 0)
     {
-        cerr << "ERROR: could not open file (might not exist)." << endl;
+        cout << "WARNING: unable to write binary cache " << cache_path << endl;
+        remove(tmp_path.str().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool IO::load_binary_cache(string cache_path,
+                           string source_path,
+                           bool edge_weights_given)
+{
+    /***
+     * Load the instance from a binary cache, if it exists, matches the current
+     * source file and weight mode, and passes the checksum. The arrays are
+     * mapped in memory and copied in bulk into the Graph object: no parsing
+     * or per-element work. Returns false (leaving this object unchanged) if
+     * the cache cannot be used.
+     */
+
+    Timer loading_clock;
+
+    const char *begin, *end;
+    size_t size;
+    if (!map_input_file(cache_path, begin, end, size))
+        return false;
+
+    if (size < sizeof(WCMBHeader))
+    {
+        unmap_input_file(begin, size);
+        return false;
+    }
+
+    WCMBHeader header;
+    memcpy(&header, begin, sizeof(header));
+
+    // 1. CHECK THE HEADER AGAINST THE SOURCE FILE (OTHERWISE THE CACHE IS STALE)
+    int64_t source_size, source_mtime;
+    bool fresh = source_file_stamp(source_path, source_size, source_mtime) &&
+                 memcmp(header.magic, WCMB_MAGIC, 4) == 0 &&
+                 header.version == WCMB_VERSION &&
+                 header.source_size == source_size &&
+                 header.source_mtime == source_mtime &&
+                 header.edge_weights_given == edge_weights_given &&
+                 header.num_vertices >= 0 && header.num_edges >= 0 &&
+                 header.instance_id_length >= 0;
+
+    // every array must fit in the file (also keeping the sizes below from
+    // overflowing), and the edge index table must have the layout built by
+    // Graph::init_edge_index: 2 words per slot, a power of two number of
+    // slots (at least 2, and at least twice the number of edges)
+    const int64_t file_words = size / 8;
+    const int64_t table_slots = header.edge_index_table_size / 2;
+    fresh = fresh &&
+            header.num_vertices < file_words && header.num_edges < file_words &&
+            header.instance_id_length < (int64_t) size &&
+            header.edge_index_table_size > 0 &&
+            header.edge_index_table_size <= file_words &&
+            header.edge_index_table_size % 2 == 0 &&
+            table_slots >= 2 && (table_slots & (table_slots - 1)) == 0 &&
+            table_slots >= 2 * header.num_edges;
+
+    if (!fresh)
+    {
+        unmap_input_file(begin, size);
+        return false;
+    }
+
+    const size_t id_words = (header.instance_id_length + 7) / 8;
+    const size_t m = header.num_edges;
+    const size_t n = header.num_vertices;
+    const size_t payload_words = id_words + 3*m + (n+1) + 4*m
+                               + header.edge_index_table_size;
+
+    fresh = fresh && (size == sizeof(header) + 8 * payload_words);
+
+    const char *payload = begin + sizeof(header);
+    if (!fresh || wcmb_checksum(payload, 8 * payload_words) != header.checksum)
+    {
+        unmap_input_file(begin, size);
+        return false;
+    }
+
+    // 2. COPY ARRAYS IN BULK
+    instance_id.assign(payload, header.instance_id_length);
+
+    size_t dot_pos = source_path.find_last_of(".");
+    size_t last_slash_pos = source_path.find_last_of("/\\");
+    instance_id_trimmed = source_path.substr(last_slash_pos+1,
+                                             dot_pos-1 - last_slash_pos);
+
+    only_nonpositive_weights = header.only_nonpositive_weights;
+
+    delete graph;
+    this->graph = new Graph(n, m);
+
+    const long *words = (const long*) (payload + 8 * id_words);
+    graph->s.assign(words, words + m);
+    words += m;
+    graph->t.assign(words, words + m);
+    words += m;
+    graph->w.assign((const double*) words, (const double*) words + m);
+    words += m;
+    graph->adj_offset.assign(words, words + n+1);
+    words += n+1;
+    graph->adj_pairs.assign(words, words + 4*m);
+    words += 4*m;
+    graph->edge_index_table.assign(words, words + header.edge_index_table_size);
+    graph->set_edge_index_slots(header.edge_index_table_size / 2);
+
+    unmap_input_file(begin, size);
+
+    this->parsing_runtime = loading_clock.realTime();
+    cout << "Binary cache " << cache_path << ": ";
+    this->parsing_throughput = report_parsing_throughput(size, parsing_runtime);
+
+    return true;
+}
+
+IO *IO::induced_subinstance(const vector<long> &vertices,
+                            const vector<long> &local_index,
+                            vector<long> &original_edge_index)
+{
+    /***
+     * New instance with the subgraph induced by the given vertices, which are
+     * renumbered 0, 1, ..., in the given order. Expects local_index[v] to be
+     * the position of v in vertices if v is one of them, and -1 if v is a
+     * neighbour outside the set. Fills original_edge_index with the index in
+     * this instance of each edge in the new one. Runs in O(size of the
+     * subgraph plus its boundary), so that many disjoint subinstances can be
+     * created in linear time overall.
+     */
+
+    // 1. COUNT EDGES (EACH ONE FROM ITS FIRST TERMINAL IN THE EDGE LIST)
+    original_edge_index.clear();
+    for (long u : vertices)
+    {
+        for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+        {
+            long v = graph->adj_pairs[2*k];
+            long e = graph->adj_pairs[2*k + 1];
+
+            if (graph->s[e] == u && local_index[v] >= 0)
+                original_edge_index.push_back(e);
+        }
+    }
+
+    // 2. BUILD THE NEW INSTANCE
+    IO *subinstance = new IO();
+    subinstance->instance_id = instance_id;
+    subinstance->instance_id_trimmed = instance_id_trimmed;
+
+    const long sub_n = vertices.size();
+    const long sub_m = original_edge_index.size();
+
+    delete subinstance->graph;
+    subinstance->graph = new Graph(sub_n, sub_m);
+    Graph *subgraph = subinstance->graph;
+
+    subinstance->only_nonpositive_weights = true;
+    for (long idx = 0; idx < sub_m; ++idx)
+    {
+        long e = original_edge_index[idx];
+        long i = local_index[graph->s[e]];
+        long j = local_index[graph->t[e]];
+
+        subgraph->s.push_back(i);
+        subgraph->t.push_back(j);
+        subgraph->w.push_back(graph->w[e]);
+        subgraph->add_edge_index(i, j, idx);
+
+        if (graph->w[e] > 0)
+            subinstance->only_nonpositive_weights = false;
+    }
+
+    subgraph->init_adjacency_arrays();
+
+    return subinstance;
+}
+
+vector<bool> IO::empty_edge_subset()
+{
+    /// indicator vector over the edges of this instance, with no edge chosen
+
+    return vector<bool>(graph->num_edges, false);
+}
+
+bool IO::is_connected_matching(const vector<bool> &edge_in_solution)
+{
+    return graph->is_connected_matching(edge_in_solution, false);
+}
+
+double IO::edge_subset_weight(const vector<bool> &edge_in_solution)
+{
+    return graph->edge_subset_weight(edge_in_solution);
+}
+
+double IO::max_weight_matching(vector<bool> &edge_in_matching)
+{
+    return graph->max_weight_matching(edge_in_matching);
+}
+
+bool IO::write_solution_file(string output_file_path,
+                             const vector<bool> &edge_in_solution,
+                             double weight)
+{
+    /***
+     * Write a solution (indicator vector over edge indices) to a text file,
+     * with a header of comment lines followed by one "u v" line per matching
+     * edge. Vertex indices are 0-based, as in the parsed graph.
+     */
+
+    ofstream solution_file(output_file_path.c_str(), ofstream::trunc);
+    if (!solution_file.is_open())
+    {
+        cout << "ERROR: unable to write solution file " << output_file_path
+             << endl;
         return false;
     }
 
-    // lemon data structure initialization
-    graph->init_lemon();
+    long num_solution_edges = 0;
+    for (long e = 0; e < graph->num_edges; ++e)
+        if (edge_in_solution[e])
+            ++num_solution_edges;
+
+    solution_file << "# instance " << instance_id_trimmed << endl;
+    solution_file << "# vertices " << graph->num_vertices
+                  << " edges " << graph->num_edges << endl;
+    solution_file << "# weight " << setprecision(15) << weight << endl;
+    solution_file << "# matching edges " << num_solution_edges << endl;
+
+    for (long e = 0; e < graph->num_edges; ++e)
+        if (edge_in_solution[e])
+            solution_file << graph->s[e] << " " << graph->t[e] << endl;
+
+    solution_file.close();
+    return true;
+}
+
+bool IO::read_solution_file(string input_file_path,
+                            vector<bool> &edge_in_solution)
+{
+    /***
+     * Read a solution written by write_solution_file (possibly for the same
+     * graph with different weights), mapping each "u v" line to the index of
+     * the corresponding edge. Returns true only if every line is an edge of
+     * this graph and the result is a connected matching.
+     */
+
+    ifstream solution_file(input_file_path.c_str());
+    if (!solution_file.is_open())
+    {
+        cout << "ERROR: could not open solution file " << input_file_path
+             << endl;
+        return false;
+    }
+
+    edge_in_solution = vector<bool>(graph->num_edges, false);
+
+    string line;
+    long line_number = 0;
+    while (getline(solution_file, line))
+    {
+        ++line_number;
+
+        stringstream line_stream(line);
+        long u, v;
+
+        if (line.find_first_not_of(" \t\r") == string::npos || line[0] == '#')
+            continue;
+
+        if (!(line_stream >> u >> v) ||
+            u < 0 || v < 0 || u >= graph->num_vertices || v >= graph->num_vertices)
+        {
+            cout << "ERROR: invalid vertex pair in solution file line "
+                 << line_number << endl;
+            return false;
+        }
+
+        long idx = graph->edge_index(u, v);
+        if (idx < 0)
+        {
+            cout << "ERROR: solution file line " << line_number
+                 << " is not an edge of the instance graph" << endl;
+            return false;
+        }
+
+        edge_in_solution[idx] = true;
+    }
+
+    if (!graph->is_connected_matching(edge_in_solution, true))
+    {
+        cout << "ERROR: solution file " << input_file_path
+             << " is not a connected matching" << endl;
+        return false;
+    }
+
+    cout << "Read solution of weight "
+         << graph->edge_subset_weight(edge_in_solution) << " from "
+         << input_file_path << endl;
 
     return true;
 }
@@ -365,3 +1011,95 @@ void IO::write_summary_info(string output_file_path)
         cout << summary_info.str();
     }
 }
+
+void IO::write_batch_record(ostream &batch_results,
+                            ModelStatus status,
+                            double lb,
+                            double ub,
+                            double gap,
+                            double time,
+                            long node_count)
+{
+    /// tab-separated line: id  n  m  status  lb  ub  gap  time  #nodes
+
+    batch_results << instance_id_trimmed << "\t"
+                  << graph->num_vertices << "\t"
+                  << graph->num_edges << "\t"
+                  << ((status == AT_OPTIMUM) ? "OPTIMAL" : "UNKNOWN") << "\t"
+                  << fixed << setprecision(2)
+                  << lb << "\t" << ub << "\t" << gap << "\t" << time << "\t"
+                  << node_count << endl;
+}
+
+void IO::save_json_field(string key, long value)
+{
+    if (json_info.tellp() > 0)
+        json_info << ", ";
+
+    json_info << "\"" << key << "\": " << value;
+}
+
+void IO::save_json_field(string key, double value)
+{
+    /// NB! json has no representation for infinity or nan
+
+    if (json_info.tellp() > 0)
+        json_info << ", ";
+
+    json_info << "\"" << key << "\": ";
+
+    if (std::isfinite(value))
+        json_info << setprecision(10) << defaultfloat << value;
+    else
+        json_info << "null";
+}
+
+void IO::save_json_field(string key, string value)
+{
+    if (json_info.tellp() > 0)
+        json_info << ", ";
+
+    json_info << "\"" << key << "\": \"";
+
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            json_info << '\\' << c;
+        else if ((unsigned char) c < 0x20)
+            json_info << "\\u" << hex << setw(4) << setfill('0') << (int) c
+                      << dec << setfill(' ');
+        else
+            json_info << c;
+    }
+
+    json_info << "\"";
+}
+
+void IO::save_json_instance_info()
+{
+    /// save instance info: id  n  m  parsing time and throughput
+
+    save_json_field("instance", instance_id_trimmed);
+    save_json_field("num_vertices", graph->num_vertices);
+    save_json_field("num_edges", graph->num_edges);
+    save_json_field("only_nonpositive_weights", (long) only_nonpositive_weights);
+    save_json_field("parsing_throughput_mb_s", parsing_throughput);
+}
+
+void IO::write_json_info(string output_file_path)
+{
+    /// write all the saved fields as a single json object (line) in the given file
+
+    ofstream json_file(output_file_path.c_str(), ofstream::app);
+    if (json_file.is_open())
+    {
+        json_file << "{" << json_info.str() << "}" << endl;
+        json_file.close();
+    }
+    else
+    {
+        cout << "ERROR: unable to write json metrics file; dumping to screen:"
+             << endl;
+        cout << "{" << json_info.str() << "}" << endl;
+    }
+}
@@ -7,6 +7,16 @@
 #include <vector>
 #include <cstring>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// memory-mapped input files
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "graph.h"
 
@@ -31,15 +41,47 @@ public:
     IO();
     virtual ~IO();
 
+    bool parse_input_file(string, bool, bool);
     bool parse_gcc_file(string);
     bool parse_stp_file(string, bool);
 
+    // binary pre-parsed instances (.wcmb), used by parse_input_file
+    string binary_cache_path(string);
+    bool write_binary_cache(string, string, bool);
+    bool load_binary_cache(string, string, bool);
+
+    IO *induced_subinstance(const vector<long> &,
+                            const vector<long> &,
+                            vector<long> &);
+
+    vector<bool> empty_edge_subset();
+    bool is_connected_matching(const vector<bool> &);
+    double edge_subset_weight(const vector<bool> &);
+    double max_weight_matching(vector<bool> &);
+
+    // solution files: one edge per line, as "u v" (0-based vertex indices)
+    bool write_solution_file(string, const vector<bool> &, double);
+    bool read_solution_file(string, vector<bool> &);
+
+    double parsing_runtime;
+    double parsing_throughput;   // MB/s
+
     void save_instance_info();
     void save_lpr_info(double, double);
     void save_bc_info(double, double, double, double, long, long, long, long);
     void save_compact_info(double, double, double, double, long);
     void write_summary_info(string);
 
+    void write_batch_record(ostream &, ModelStatus,
+                            double, double, double, double, long);
+
+    // machine-readable record of a run: one json object per line
+    void save_json_field(string, long);
+    void save_json_field(string, double);
+    void save_json_field(string, string);
+    void save_json_instance_info();
+    void write_json_info(string);
+
     // instance data
     string instance_id;
     string instance_id_trimmed;
@@ -49,8 +91,14 @@ private:
     friend class CompactWCMModel;
     friend class WCMModel;
     friend class WCMCutGenerator;
+    friend class WCMDecomposition;
+    friend class WCMReduction;
+    friend class WCMHeuristic;
+    friend class WCMMetaheuristic;
+    friend class WCMLNS;
 
     stringstream summary_info;  // latex table row summary
+    stringstream json_info;     // "key": value pairs of the json record
 
     Graph *graph;  // different representations of the original graph
 };
@@ -12,10 +12,16 @@
 #include "io.h"
 #include "wcm_model.h"
 #include "wcm_compact.h"
+#include "wcm_decomposition.h"
+#include "wcm_reduction.h"
+#include "wcm_heuristic.h"
+#include "wcm_metaheuristic.h"
+#include "wcm_lns.h"
 
 #include <cstdlib>
 #include <fstream>
 #include <string>
+#include <sstream>
 
 using namespace std;
 
@@ -23,68 +29,489 @@ using namespace std;
 bool SEPARATORS_BASED_FORMULATION = false;
 double RUN_WCM_WITH_TIME_LIMIT = 3600.0;
 
+// delete vertices that some optimal solution does not cover, before solving
+bool APPLY_REDUCTIONS = true;
+
+// solve connected components independently, on a pool of threads (0 for one
+// per hardware thread), whenever more than one component has edges
+bool DECOMPOSE_INTO_COMPONENTS = true;
+long DECOMPOSITION_THREADS = 0;
+
+// bound the optimum by a maximum weight matching (disregarding connectivity),
+// which is also optimal if connected; otherwise, it stops the solver early
+bool MATCHING_UPPER_BOUND = true;
+
+// greedy connected matchings grown from the heaviest edges, as a MIP start
+bool GREEDY_MIP_START = true;
+long GREEDY_MIP_START_SEEDS = 50;
+
+// optimal connected matchings within a maximum weight spanning tree and some
+// bfs trees, solved in parallel (0 threads for one per hardware thread), as a
+// MIP start
+bool SPANNING_TREE_MIP_START = true;
+long SPANNING_TREE_BFS_TREES = 8;
+long SPANNING_TREE_THREADS = 0;
+
+// large neighbourhood search around the incumbent, in a separate thread, while
+// solving the separators-based formulation (without decomposition)
+bool LARGE_NEIGHBOURHOOD_SEARCH = true;
+
+// --heuristic-only: iterated local search on a pool of threads (0 for one per
+// hardware thread), stopping on a time limit or a total number of iterations
+// (0 for no limit); no integer program is built
+double HEURISTIC_ONLY_TIME_LIMIT = 60.0;
+long HEURISTIC_ONLY_MAX_ITERATIONS = 0;
+long HEURISTIC_ONLY_THREADS = 0;
+
+// reuse (or create) a binary pre-parsed copy of the instance (.wcmb file)
+bool USE_BINARY_INSTANCE_CACHE = true;
+
 bool WRITE_LATEX_TABLE_ROW = true;
 string LATEX_TABLE_FILE_PATH = string("xp15.dat");
 
+// machine-readable metrics: one json object (line) per run
+bool WRITE_JSON_METRICS = true;
+string JSON_METRICS_FILE_PATH = string("metrics.jsonl");
+
+// batch mode: one record per instance, appended as soon as it is solved
+string BATCH_RESULTS_FILE_PATH = string("batch_results.dat");
+
 // switches concerning the exponential formulation only
 bool DEDICATED_LP_RELAXATION = true;
 double DEDICATED_LPR_TIME_LIMIT = 300;
 bool DEDICATED_LPR_GRB_CUTS_OFF = false;
 
-int main(int argc, char **argv)
+// main results of a run, for the output files
+struct RunResults
+{
+    ModelStatus status = STATUS_UNKNOWN;
+    double primal_bound = numeric_limits<double>::max();
+    double dual_bound = numeric_limits<double>::max();
+    double gap = GRB_INFINITY;
+    double runtime = 0;
+    long num_nodes = 0;
+    long blossom_counter = 0;
+    long msi_counter = 0;
+    long indegree_counter = 0;
+
+    bool has_solution = false;
+    vector<bool> reduced_solution;  // edges of the instance actually solved
+    vector<bool> solution;          // edges of the original instance
+};
+
+// options for solving one instance, from the command line or a manifest line
+struct RunOptions
 {
+    string file_path;
+    bool stp_with_edge_weights = false;
+    string mip_start_path;          // empty if not given
+    string solution_output_path;    // empty if not given
+    bool heuristic_only = false;
+};
+
+void inline print_usage(char *program_name)
+{
+    cout << endl << "usage: \t" << program_name
+         << " input_instance_path [-e] [--mip-start path] [--write-solution path]"
+         << " [--heuristic-only]" << endl;
+    cout << "       \t" << program_name
+         << " --batch manifest_path" << endl << endl;
+    cout << "[-e]: flag indicating .stp format instance WITH edge weights"
+         << endl;
+    cout << "--mip-start: solution file (e.g. from --write-solution) to warm"
+         << " start the solver, after checking it is a connected matching"
+         << endl;
+    cout << "--write-solution: write the best solution found to the given file"
+         << endl;
+    cout << "--heuristic-only: run only a multi-threaded iterated local search"
+         << " (anytime, without dual bound), e.g. for very large instances"
+         << endl;
+    cout << "--batch: solve every instance listed in the manifest file, one per"
+         << " line as \"input_instance_path [options]\" (lines starting with #"
+         << " are ignored), in the same process and Gurobi environment" << endl
+         << endl;
+}
+
+bool inline parse_run_options(vector<string> &args,
+                              bool legacy_extra_args,
+                              RunOptions &options)
+{
+    /***
+     * Fill options from args = {input_instance_path, options...}. If
+     * legacy_extra_args is set, unknown arguments are taken as -e, as in
+     * previous versions; otherwise, they are reported and ignored.
+     */
+
+    options = RunOptions();
+    options.file_path = args.at(0);
+
+    for (unsigned long i = 1; i < args.size(); ++i)
+    {
+        if (args[i].compare("-e") == 0)
+            options.stp_with_edge_weights = true;
+
+        else if (args[i].compare("--heuristic-only") == 0)
+            options.heuristic_only = true;
+
+        else if (args[i].compare("--mip-start") == 0 ||
+                 args[i].compare("--write-solution") == 0)
+        {
+            if (i+1 >= args.size())
+            {
+                cout << "ERROR: missing path after " << args[i] << endl;
+                return false;
+            }
+
+            if (args[i].compare("--mip-start") == 0)
+                options.mip_start_path = args[i+1];
+            else
+                options.solution_output_path = args[i+1];
+
+            ++i;
+        }
+
+        else if (legacy_extra_args)
+            options.stp_with_edge_weights = true;
+
+        else
+            cout << "WARNING: ignoring unknown flag " << args[i]
+                 << " for " << options.file_path << endl;
+    }
+
+    return true;
+}
+
+void inline save_json_phase_time(IO *instance, string phase, Timer &phase_clock)
+{
+    /// wall and (process) cpu time since the last restart of phase_clock
+
+    instance->save_json_field(phase + "_wall_time", phase_clock.realTime());
+    instance->save_json_field(phase + "_cpu_time",
+                              phase_clock.userTime() + phase_clock.systemTime());
+    phase_clock.restart();
+}
+
+void inline save_run_results(IO *instance,
+                             RunOptions &options,
+                             RunResults &results,
+                             ostream *batch_results)
+{
+    /// write the results of a run to each of the output files enabled
+
+    if (!options.solution_output_path.empty() && results.has_solution)
+        instance->write_solution_file(options.solution_output_path,
+                                      results.solution,
+                                      results.primal_bound);
+
+    if (WRITE_JSON_METRICS)
+        instance->write_json_info(JSON_METRICS_FILE_PATH);
+
+    if (WRITE_LATEX_TABLE_ROW)
+    {
+        if (SEPARATORS_BASED_FORMULATION)
+            instance->save_bc_info(results.primal_bound,
+                                   results.dual_bound,
+                                   results.gap,
+                                   results.runtime,
+                                   results.num_nodes,
+                                   results.blossom_counter,
+                                   results.msi_counter,
+                                   results.indegree_counter);
+        else
+            instance->save_compact_info(results.primal_bound,
+                                        results.dual_bound,
+                                        results.gap,
+                                        results.runtime,
+                                        results.num_nodes);
+
+        instance->write_summary_info(LATEX_TABLE_FILE_PATH);
+    }
+
+    if (batch_results)
+        instance->write_batch_record(*batch_results,
+                                     results.status,
+                                     results.primal_bound,
+                                     results.dual_bound,
+                                     results.gap,
+                                     results.runtime,
+                                     results.num_nodes);
+}
+
+int run_instance(RunOptions &options,
+                 GRBEnv *env,
+                 vector<GRBEnv*> *worker_envs,
+                 ostream *batch_results)
+{
+    /***
+     * Parse and solve a single instance, using the given Gurobi environment
+     * (or a dedicated one, if env is NULL). Threads solving models of their own
+     * (decomposition workers, or the lns) use the given worker environments,
+     * adding to them as needed, or dedicated ones if worker_envs is NULL. If
+     * batch_results is given, a record with the main results is written (and
+     * flushed) there.
+     * Returns 0 on success and 1 if the input file could not be parsed.
+     */
+
     // 1. PARSE INPUT FILE
 
+    Timer phase_clock;
     IO* instance = new IO();
 
-    if (argc < 2)
+    bool successful_parsing = instance->parse_input_file(options.file_path,
+                                                         options.stp_with_edge_weights,
+                                                         USE_BINARY_INSTANCE_CACHE);
+
+    if (!successful_parsing)
     {
-        cout << endl << "usage: \t" << argv[0]
-             << " input_instance_path [-e]" << endl << endl;
-        cout << "[-e]: flag indicating .stp format instance WITH edge weights"
-             << endl << endl;
+        cout << "unable to parse input file" << endl;
+
+        if (batch_results)
+            (*batch_results) << options.file_path << "\tPARSING_ERROR" << endl;
 
         delete instance;
-        return 0;
+        return 1;
     }
-    else
+
+    // optional warm start, checked against the instance graph
+    vector<bool> mip_start;
+    bool use_mip_start = !options.mip_start_path.empty() &&
+                         instance->read_solution_file(options.mip_start_path,
+                                                      mip_start);
+
+    if (WRITE_LATEX_TABLE_ROW)
+        instance->save_instance_info();
+
+    if (WRITE_JSON_METRICS)
+    {
+        instance->save_json_instance_info();
+        save_json_phase_time(instance, "parsing", phase_clock);
+    }
+
+    // 2. REDUCTIONS: MODELS BELOW ARE BUILT ON THE REDUCED INSTANCE, AND THEIR
+    // SOLUTIONS ARE LIFTED BACK (RESULTS ARE ALWAYS SAVED IN THE ORIGINAL ONE)
+
+    WCMReduction *reduction = NULL;
+    IO *reduced_instance = instance;
+
+    if (APPLY_REDUCTIONS)
+    {
+        reduction = new WCMReduction(instance);
+        reduced_instance = reduction->reduce();
+
+        if (use_mip_start)
+        {
+            vector<bool> reduced_mip_start;
+            if (reduction->restrict_solution(mip_start, reduced_mip_start))
+                mip_start = reduced_mip_start;
+            else
+            {
+                cout << "WARNING: MIP start uses edges removed by reductions;"
+                     << " ignoring it" << endl;
+                use_mip_start = false;
+            }
+        }
+
+        if (WRITE_JSON_METRICS)
+        {
+            reduction->save_json_info(instance);
+            save_json_phase_time(instance, "reduction", phase_clock);
+        }
+    }
+
+    RunResults results;
+
+    // optional upper bound from a maximum weight matching
+    vector<bool> matching;
+    double matching_bound = numeric_limits<double>::max();
+    double matching_runtime = 0;
+    bool matching_is_optimal = false;
+
+    if (MATCHING_UPPER_BOUND && !options.heuristic_only &&
+        !reduced_instance->only_nonpositive_weights)
+    {
+        Timer matching_clock;
+        matching_bound = reduced_instance->max_weight_matching(matching);
+        matching_is_optimal = reduced_instance->is_connected_matching(matching);
+        matching_runtime = matching_clock.realTime();
+
+        cout << "Maximum weight matching bound: " << matching_bound << " ("
+             << matching_runtime << " s)"
+             << (matching_is_optimal ? ", connected" : "") << endl;
+
+        if (WRITE_JSON_METRICS)
+        {
+            instance->save_json_field("matching_bound", matching_bound);
+            save_json_phase_time(instance, "matching_bound", phase_clock);
+        }
+    }
+
+    // heuristic solutions, used as MIP start if better than a given one
+    if ((GREEDY_MIP_START || SPANNING_TREE_MIP_START) && !matching_is_optimal &&
+        !reduced_instance->only_nonpositive_weights)
     {
-        bool stp_with_edge_weights = (argc > 2);
+        WCMHeuristic *heuristic = new WCMHeuristic(reduced_instance);
+
+        double start_weight = use_mip_start ?
+            reduced_instance->edge_subset_weight(mip_start) : 0;
+
+        vector<bool> heuristic_solution;
+        double heuristic_weight;
+
+        if (GREEDY_MIP_START)
+        {
+            heuristic_weight =
+                heuristic->greedy_connected_matching(heuristic_solution,
+                                                     GREEDY_MIP_START_SEEDS);
+
+            if (!use_mip_start || heuristic_weight > start_weight)
+            {
+                mip_start = heuristic_solution;
+                start_weight = heuristic_weight;
+                use_mip_start = true;
+            }
+        }
+
+        if (SPANNING_TREE_MIP_START)
+        {
+            heuristic_weight =
+                heuristic->spanning_tree_dp(heuristic_solution,
+                                            SPANNING_TREE_BFS_TREES,
+                                            SPANNING_TREE_THREADS);
 
-        string file_path = string(argv[1]);
-        string file_extension = file_path.substr(file_path.find_last_of(".")+1);
+            if (!use_mip_start || heuristic_weight > start_weight)
+            {
+                mip_start = heuristic_solution;
+                start_weight = heuristic_weight;
+                use_mip_start = true;
+            }
+        }
+
+        if (WRITE_JSON_METRICS)
+        {
+            heuristic->save_json_info(instance);
+            save_json_phase_time(instance, "heuristic", phase_clock);
+        }
 
-        bool successful_parsing = (file_extension.compare("gcc") == 0) ?
-                                  instance->parse_gcc_file(file_path) :
-                                  instance->parse_stp_file(file_path, stp_with_edge_weights);
+        delete heuristic;
+    }
+
+    WCMDecomposition *decomposition = NULL;
+    if (DECOMPOSE_INTO_COMPONENTS && !matching_is_optimal &&
+        !options.heuristic_only && !reduced_instance->only_nonpositive_weights)
+    {
+        decomposition = new WCMDecomposition(reduced_instance, worker_envs);
 
-        if (!successful_parsing)
+        if (decomposition->num_components < 2)
         {
-                cout << "unable to parse input file" << endl;
-                delete instance;
-                return 0;
+            delete decomposition;
+            decomposition = NULL;
         }
     }
 
-    /*
-    if (instance->only_nonpositive_weights)
+    if (reduced_instance->only_nonpositive_weights)
     {
+        // 3.0 TRIVIAL CASE (INCLUDING AN EMPTY GRAPH): EMPTY SOLUTION IS OPTIMAL
+
         cout << endl << "*** All edges in instance " << instance->instance_id
-             << " have non-positive weight." << endl;
+             << " (after reductions) have non-positive weight." << endl;
         cout << endl << "*** Empty solution is optimal." << endl;
 
-        return 0;
+        results.status = AT_OPTIMUM;
+        results.primal_bound = results.dual_bound = 0;
+        results.gap = results.runtime = 0;
+        results.has_solution = true;
+        results.reduced_solution = reduced_instance->empty_edge_subset();
+
+        if (WRITE_LATEX_TABLE_ROW)
+            instance->save_lpr_info(0, 0);
     }
-    */
+    else if (matching_is_optimal)
+    {
+        // 3.0 TRIVIAL CASE: MAXIMUM WEIGHT MATCHING IS ALREADY CONNECTED
 
-    if (WRITE_LATEX_TABLE_ROW)
-        instance->save_instance_info();
+        cout << endl << "*** Maximum weight matching in instance "
+             << instance->instance_id << " is connected, thus optimal." << endl;
+
+        results.status = AT_OPTIMUM;
+        results.primal_bound = results.dual_bound = matching_bound;
+        results.gap = 0;
+        results.runtime = matching_runtime;
+        results.has_solution = true;
+        results.reduced_solution = matching;
+
+        if (WRITE_LATEX_TABLE_ROW)
+            instance->save_lpr_info(matching_bound, 0);
+    }
+    else if (options.heuristic_only)
+    {
+        // 3.H ITERATED LOCAL SEARCH ONLY (NO DUAL BOUND)
+
+        WCMMetaheuristic *metaheuristic = new WCMMetaheuristic(reduced_instance);
 
-    if (SEPARATORS_BASED_FORMULATION)
+        if (use_mip_start)
+            metaheuristic->set_incumbent(mip_start);
+
+        metaheuristic->solve(HEURISTIC_ONLY_TIME_LIMIT,
+                             HEURISTIC_ONLY_MAX_ITERATIONS,
+                             HEURISTIC_ONLY_THREADS);
+
+        if (WRITE_LATEX_TABLE_ROW)
+            instance->save_lpr_info(-1, -1);
+
+        if (WRITE_JSON_METRICS)
+            metaheuristic->save_json_info(instance);
+
+        results.status = STATUS_UNKNOWN;
+        results.primal_bound = metaheuristic->solution_weight;
+        results.runtime = metaheuristic->solution_runtime;
+        results.has_solution = true;
+        results.reduced_solution = metaheuristic->solution_vector_x;
+
+        delete metaheuristic;
+    }
+    else if (decomposition)
     {
-        // 2.A INTEGER PROGRAM CORRESPONDING TO THE SEPARATORS-BASED FORMULATION
+        // 3.1 ONE INTEGER PROGRAM PER CONNECTED COMPONENT (EITHER FORMULATION)
+        // NB! no dedicated LP relaxation in this case
 
-        WCMModel *model = new WCMModel(instance);
+        if (use_mip_start)
+            decomposition->set_incumbent(mip_start);
+
+        if (MATCHING_UPPER_BOUND)
+            decomposition->set_matching_bound(matching);
+
+        decomposition->solve(SEPARATORS_BASED_FORMULATION,
+                             RUN_WCM_WITH_TIME_LIMIT,
+                             DECOMPOSITION_THREADS);
+
+        if (WRITE_LATEX_TABLE_ROW)
+            instance->save_lpr_info(-1, -1);
+
+        if (WRITE_JSON_METRICS)
+            decomposition->save_json_info(instance);
+
+        results.status = decomposition->solution_status;
+        results.primal_bound = decomposition->solution_weight;
+        results.dual_bound = decomposition->solution_dualbound;
+        results.gap = decomposition->get_mip_gap();
+        results.runtime = decomposition->solution_runtime;
+        results.num_nodes = decomposition->mip_num_nodes;
+        results.blossom_counter = decomposition->blossom_counter;
+        results.msi_counter = decomposition->msi_counter;
+        results.indegree_counter = decomposition->indegree_counter;
+        results.has_solution = true;
+        results.reduced_solution = decomposition->solution_vector_x;
+
+        delete decomposition;
+    }
+    else if (SEPARATORS_BASED_FORMULATION)
+    {
+        // 3.A INTEGER PROGRAM CORRESPONDING TO THE SEPARATORS-BASED FORMULATION
+
+        WCMModel *model = new WCMModel(reduced_instance, env);
+
+        if (WRITE_JSON_METRICS)
+            save_json_phase_time(instance, "model_construction", phase_clock);
 
         if (DEDICATED_LP_RELAXATION)
         {
@@ -94,52 +521,249 @@ int main(int argc, char **argv)
 
             if (WRITE_LATEX_TABLE_ROW)
                 instance->save_lpr_info(model->lp_bound, model->lp_runtime);
+
+            if (WRITE_JSON_METRICS)
+                save_json_phase_time(instance, "lp_relaxation", phase_clock);
         }
         
+        if (use_mip_start)
+            model->set_mip_start(mip_start);
+
+        if (MATCHING_UPPER_BOUND)
+            model->set_objective_upper_bound(matching_bound);
+
         model->set_time_limit(RUN_WCM_WITH_TIME_LIMIT - model->lp_runtime);
+
+        WCMLNS *lns = NULL;
+        if (LARGE_NEIGHBOURHOOD_SEARCH)
+        {
+            // NB! no decomposition worker runs at the same time as the lns
+            GRBEnv *lns_env = NULL;
+            if (worker_envs && add_worker_envs(*worker_envs, 1) > 0)
+                lns_env = worker_envs->front();
+
+            lns = new WCMLNS(reduced_instance, lns_env);
+            lns->start(use_mip_start ? mip_start
+                                     : reduced_instance->empty_edge_subset(),
+                       RUN_WCM_WITH_TIME_LIMIT - model->lp_runtime);
+            model->set_lns(lns);
+        }
+
         model->solve(true);
 
-        if (WRITE_LATEX_TABLE_ROW)
+        // NB! the lns may have improved on the incumbent after the last callback
+        vector<bool> lns_solution;
+        double lns_weight = 0;
+        bool lns_improved = false;
+
+        if (lns)
+        {
+            lns->stop();
+            lns_improved = lns->take_improvement(lns_solution, lns_weight);
+
+            if (WRITE_JSON_METRICS)
+                lns->save_json_info(instance);
+
+            model->set_lns(NULL);
+            delete lns;
+        }
+
+        if (WRITE_JSON_METRICS)
+            model->save_json_info(instance);
+
+        results.status = model->solution_status;
+        results.primal_bound = model->solution_weight;
+        results.dual_bound = model->solution_dualbound;
+        results.gap = model->get_mip_gap();
+        results.runtime = model->get_mip_runtime();
+        results.num_nodes = model->get_mip_num_nodes();
+        results.blossom_counter = model->get_mip_blossom_counter();
+        results.msi_counter = model->get_mip_msi_counter();
+        results.indegree_counter = model->get_mip_indegree_counter();
+        results.has_solution = (model->solution_weight < numeric_limits<double>::max());
+        results.reduced_solution = model->solution_vector_x;
+
+        if (lns_improved && (!results.has_solution ||
+                             lns_weight > results.primal_bound))
         {
-            instance->save_bc_info(model->solution_weight,
-                                   model->solution_dualbound,
-                                   model->get_mip_gap(),
-                                   model->get_mip_runtime(),
-                                   model->get_mip_num_nodes(),
-                                   model->get_mip_blossom_counter(),
-                                   model->get_mip_msi_counter(),
-                                   model->get_mip_indegree_counter());
-            instance->write_summary_info(LATEX_TABLE_FILE_PATH);
+            results.primal_bound = lns_weight;
+            results.gap = fabs(results.dual_bound - lns_weight) / fabs(lns_weight);
+            results.has_solution = true;
+            results.reduced_solution = lns_solution;
         }
 
         delete model;
     }
     else
     {
-        // 2.B INTEGER PROGRAM CORRESPONDING TO THE COMPACT, ARC-FLOW FORMULATION
+        // 3.B INTEGER PROGRAM CORRESPONDING TO THE COMPACT, ARC-FLOW FORMULATION
 
-        CompactWCMModel *model = new CompactWCMModel(instance);
+        CompactWCMModel *model = new CompactWCMModel(reduced_instance, env);
+
+        if (WRITE_JSON_METRICS)
+            save_json_phase_time(instance, "model_construction", phase_clock);
 
         model->solve_lp_relax(false, RUN_WCM_WITH_TIME_LIMIT);
         if (WRITE_LATEX_TABLE_ROW)
             instance->save_lpr_info(model->lp_bound, model->lp_runtime);
+
+        if (WRITE_JSON_METRICS)
+            save_json_phase_time(instance, "lp_relaxation", phase_clock);
         
+        if (use_mip_start)
+            model->set_mip_start(mip_start);
+
+        if (MATCHING_UPPER_BOUND)
+            model->set_objective_upper_bound(matching_bound);
+
         model->set_time_limit(RUN_WCM_WITH_TIME_LIMIT - model->lp_runtime);
         model->solve(true);
 
-        if (WRITE_LATEX_TABLE_ROW)
-        {
-            instance->save_compact_info(model->solution_weight,
-                                        model->solution_dualbound,
-                                        model->get_mip_gap(),
-                                        model->get_mip_runtime(),
-                                        model->get_mip_num_nodes());
-            instance->write_summary_info(LATEX_TABLE_FILE_PATH);
-        }
+        if (WRITE_JSON_METRICS)
+            model->save_json_info(instance);
+
+        results.status = model->solution_status;
+        results.primal_bound = model->solution_weight;
+        results.dual_bound = model->solution_dualbound;
+        results.gap = model->get_mip_gap();
+        results.runtime = model->get_mip_runtime();
+        results.num_nodes = model->get_mip_num_nodes();
+        results.has_solution = (model->solution_weight < numeric_limits<double>::max());
+        results.reduced_solution = model->solution_vector_x;
 
         delete model;
     }
 
+    // 4. LIFT SOLUTION AND SAVE RESULTS
+
+    if (WRITE_JSON_METRICS)
+        save_json_phase_time(instance, "branch_and_cut", phase_clock);
+
+    results.solution = reduction ? reduction->lift_solution(results.reduced_solution)
+                                 : results.reduced_solution;
+
+    save_run_results(instance, options, results, batch_results);
+
+    delete reduction;
     delete instance;
     return 0;
 }
+
+int run_batch(string manifest_path)
+{
+    /***
+     * Solve all instances listed in the manifest file within the same process,
+     * sharing a single Gurobi environment, so that short instances are not
+     * dominated by process startup, license checkout and environment creation.
+     * Likewise, the environments of threads solving models concurrently
+     * (decomposition workers and the lns) are started at most once per batch.
+     */
+
+    ifstream manifest(manifest_path.c_str());
+    if (!manifest.is_open())
+    {
+        cout << "ERROR: could not open manifest file " << manifest_path << endl;
+        return 1;
+    }
+
+    ofstream batch_results(BATCH_RESULTS_FILE_PATH.c_str(), ofstream::app);
+    if (!batch_results.is_open())
+    {
+        cout << "ERROR: unable to write batch results file "
+             << BATCH_RESULTS_FILE_PATH << endl;
+        return 1;
+    }
+
+    GRBEnv *env = NULL;
+    try
+    {
+        env = new GRBEnv();
+    }
+    catch(GRBException e)
+    {
+        cout << "Environment creation error, code = " << e.getErrorCode() << endl;
+        cout << e.getMessage() << endl;
+        return 1;
+    }
+
+    // started on demand by the first instance needing them, then reused
+    vector<GRBEnv*> worker_envs;
+
+    long num_instances = 0;
+    long num_failures = 0;
+
+    string line;
+    while (getline(manifest, line))
+    {
+        // 1. READ "input_instance_path [options]", SKIPPING BLANK AND COMMENT LINES
+        stringstream line_stream(line);
+        vector<string> args;
+        string arg;
+
+        while (line_stream >> arg)
+            args.push_back(arg);
+
+        if (args.empty() || args[0][0] == '#')
+            continue;
+
+        RunOptions options;
+        if (!parse_run_options(args, false, options))
+        {
+            ++num_failures;
+            continue;
+        }
+
+        // 2. SOLVE IT IN THE SHARED ENVIRONMENT
+        ++num_instances;
+        cout << endl << "*** [batch] instance " << num_instances << ": "
+             << options.file_path << endl;
+
+        num_failures += run_instance(options, env, &worker_envs, &batch_results);
+    }
+
+    cout << endl << "*** [batch] " << num_instances << " instances, "
+         << num_failures << " failed; results in "
+         << BATCH_RESULTS_FILE_PATH << endl;
+
+    batch_results.close();
+    for (GRBEnv *worker_env : worker_envs)
+        delete worker_env;
+    delete env;
+
+    return (num_failures > 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    string first_arg = string(argv[1]);
+
+    if (first_arg.compare("--batch") == 0)
+    {
+        if (argc < 3)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+
+        return run_batch(string(argv[2]));
+    }
+
+    // NB! any unknown extra argument is taken as -e, as in previous versions
+    vector<string> args(argv + 1, argv + argc);
+    RunOptions options;
+    if (!parse_run_options(args, true, options))
+    {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    run_instance(options, NULL, NULL, NULL);
+
+    return 0;
+}
@@ -6,8 +6,10 @@ const bool GRB_HEURISTICS_FOCUS = false; // extra focus on gurobi heuristics
 
 const double EPSILON_TOL = 1e-5;
 
-CompactWCMModel::CompactWCMModel(IO *instance)
+CompactWCMModel::CompactWCMModel(IO *instance, GRBEnv *shared_env)
 {
+    /// optional shared_env is used but not owned (see WCMModel constructor)
+
     this->instance = instance;
     this->num_vertices = instance->graph->num_vertices;
     this->num_edges = instance->graph->num_edges;
@@ -17,15 +19,18 @@ CompactWCMModel::CompactWCMModel(IO *instance)
     this->solution_dualbound = numeric_limits<double>::max();
     this->solution_status = STATUS_UNKNOWN;
     this->solution_runtime = -1;
+    this->objective_upper_bound = numeric_limits<double>::max();
 
     this->solution_vector_x = vector<bool>(num_edges, false);
     this->solution_vector_y = vector<bool>(num_vertices, false);
 
     this->lp_bound = this->lp_runtime = -1;
 
+    this->owns_env = (shared_env == NULL);
+
     try
     {
-        this->env = new GRBEnv();
+        this->env = owns_env ? new GRBEnv() : shared_env;
         this->model = new GRBModel(*env);
 
         create_variables();
@@ -47,7 +52,9 @@ CompactWCMModel::~CompactWCMModel()
     delete[] y;
     delete[] f;
     delete model;
-    delete env;
+
+    if (owns_env)
+        delete env;
 }
 
 void CompactWCMModel::create_variables()
@@ -93,11 +100,10 @@ void CompactWCMModel::create_constraints()
     {
         GRBLinExpr deg_ineq = 0;
 
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
             deg_ineq += x[e];
         }
 
@@ -111,11 +117,10 @@ void CompactWCMModel::create_constraints()
     {
         GRBLinExpr link_xy = 0;
 
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
 
             long v_to_u_arc_idx = instance->graph->t.at(e) == u ? e : e+num_edges;
             link_xy += y[v_to_u_arc_idx];
@@ -126,11 +131,10 @@ void CompactWCMModel::create_constraints()
         link_xy += y[s_to_u_arc_idx];
 
         // from the rhs: sum of (undirected) edges including u
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
             link_xy -= x[e];
         }
 
@@ -153,23 +157,21 @@ void CompactWCMModel::create_constraints()
     // 4. MAY OPEN ARC LEAVING U ONLY IF THERE EXISTS AN ARC ENTERING U
     for (long u = 0; u < num_vertices; ++u)
     {
-        list<long>::iterator neighbours_of_u = instance->graph->adj_list.at(u).begin();
-        while (neighbours_of_u != instance->graph->adj_list.at(u).end())
+        for (long neighbour_k = instance->graph->adj_offset[u];
+             neighbour_k < instance->graph->adj_offset[u+1]; ++neighbour_k)
         {
             // lhs: only the arc leaving u
-            long neighbour = *neighbours_of_u;
-            long edge_idx = instance->graph->index_matrix[u][neighbour];
+            long edge_idx = instance->graph->adj_pairs[2*neighbour_k + 1];
             long leaving_arc_idx = instance->graph->s.at(edge_idx) == u ? edge_idx : edge_idx+num_edges;
 
             GRBLinExpr leave_only_if_enter_cnstr = 0;
             leave_only_if_enter_cnstr += y[leaving_arc_idx];
 
             // from the rhs: arcs incident to u
-            for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-                 it != instance->graph->adj_list.at(u).end(); ++it)
+            for (long k = instance->graph->adj_offset[u];
+                 k < instance->graph->adj_offset[u+1]; ++k)
             {
-                long v = *it;
-                long e = instance->graph->index_matrix[u][v];
+                long e = instance->graph->adj_pairs[2*k + 1];
 
                 long v_to_u_arc_idx = instance->graph->t.at(e) == u ? e : e+num_edges;
                 leave_only_if_enter_cnstr -= y[v_to_u_arc_idx];
@@ -182,8 +184,6 @@ void CompactWCMModel::create_constraints()
             cname.str("");
             cname << "C4_LEAVE_ONLY_IF_ENTER_VERTEX_" << u;
             model->addConstr(leave_only_if_enter_cnstr <= 0, cname.str());
-
-            ++neighbours_of_u;
         }
     }
 
@@ -225,11 +225,10 @@ void CompactWCMModel::create_constraints()
         GRBLinExpr flow_balance = 0;
 
         // lhs first sum: flow entering u
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
 
             long entering_arc_idx = instance->graph->t.at(e) == u ? e : e+num_edges;
             flow_balance += f[entering_arc_idx];
@@ -240,22 +239,20 @@ void CompactWCMModel::create_constraints()
         flow_balance += f[s_to_u_arc_idx];
 
         // lhs second sum: -1 times flow leaving u
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
 
             long leaving_arc_idx = instance->graph->s.at(e) == u ? e : e+num_edges;
             flow_balance -= f[leaving_arc_idx];
         }
 
         // from the rhs: arcs entering u (1 if covered, 0 otherwise cf. constraints 2.)
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
 
             long entering_arc_idx = instance->graph->t.at(e) == u ? e : e+num_edges;
             flow_balance -= y[entering_arc_idx];
@@ -335,11 +332,10 @@ bool CompactWCMModel::check_solution()
         {
             bool chosen_vertex_indeed_covered = false;
 
-            for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-                 it != instance->graph->adj_list.at(u).end(); ++it)
+            for (long k = instance->graph->adj_offset[u];
+                 k < instance->graph->adj_offset[u+1]; ++k)
             {
-                long v = *it;
-                long edge_idx = instance->graph->index_matrix[u][v];
+                long edge_idx = instance->graph->adj_pairs[2*k + 1];
                 if (solution_vector_x.at(edge_idx))
                     chosen_vertex_indeed_covered = true;
             }
@@ -354,11 +350,11 @@ bool CompactWCMModel::check_solution()
         {
             bool missing_vertex_indeed_not_covered = true;
 
-            for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-                 it != instance->graph->adj_list.at(u).end(); ++it)
+            for (long k = instance->graph->adj_offset[u];
+                 k < instance->graph->adj_offset[u+1]; ++k)
             {
-                long v = *it;
-                long edge_idx = instance->graph->index_matrix[u][v];
+                long v = instance->graph->adj_pairs[2*k];
+                long edge_idx = instance->graph->adj_pairs[2*k + 1];
                 if (solution_vector_x.at(edge_idx))
                 {
                     missing_vertex_indeed_not_covered = false;
@@ -381,73 +377,10 @@ bool CompactWCMModel::check_solution()
         }
     }
 
-    // II. X VARS INDUCE A MATCHING
-
-    vector<long> degree_in_solution = vector<long>(num_vertices, 0);
-    bool still_a_matching = true;
-
-    for (long e = 0; e < num_edges; ++e)
-    {
-        if (solution_vector_x.at(e))
-        {
-            long v1 = instance->graph->s.at(e);
-            long v2 = instance->graph->t.at(e);
-            degree_in_solution.at(v1)++;
-            degree_in_solution.at(v2)++;
-
-            if (degree_in_solution.at(v1) > 1 || degree_in_solution.at(v2) > 1)
-                still_a_matching = false;
-        }
-    }
-
-    if (!still_a_matching)
-    {
-        cout << endl << "ERROR (MATCHING): some vertex has degree above 1" << endl;
-        return false;
-    }
-
+    // II. X VARS INDUCE A MATCHING, AND III. Y VARS INDUCE A CONNECTED
+    // SUBGRAPH (after part I, y is exactly the set of vertices covered by x)
 
-    // III. Y VARS INDUCE A CONNECTED SUBGRAPH
-
-    long num_components = 0;
-    vector<bool> seen = vector<bool>(num_vertices, false);
-
-    for (long u = 0; u < num_vertices; ++u)
-    {
-        // should enter only once, from the first covered vertex 
-        if (solution_vector_y.at(u) && !seen.at(u))
-        {
-            dfs_to_tag_component(u, seen);
-            ++num_components;
-        }
-    }
-
-    if (num_components > 1)
-    {
-        cout << endl
-             << "ERROR (CONNECTIVITY): subgraph induced by y is not connected ("
-             << num_components << " components)" << endl;
-        return false;
-    }
-
-    return true;
-}
-
-void CompactWCMModel::dfs_to_tag_component(long u,
-                                    vector<bool> &seen)
-{
-    // auxiliary dfs to check the connected component from vertex u
-
-    seen.at(u) = true;
-
-    for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-         it != instance->graph->adj_list.at(u).end(); ++it)
-    {
-        long v = *it;
-
-        if (solution_vector_y.at(v) && !seen.at(v))
-            dfs_to_tag_component(v, seen);
-    }
+    return instance->graph->is_connected_matching(solution_vector_x, true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -464,7 +397,9 @@ int CompactWCMModel::save_optimization_status()
     this->solution_vector_x = vector<bool>(num_edges, false);
     this->solution_vector_y = vector<bool>(num_vertices, false);
 
-    if (model->get(GRB_IntAttr_Status) == GRB_OPTIMAL)
+    // NB! stopping at BestObjStop (a valid upper bound) also means optimality
+    if (model->get(GRB_IntAttr_Status) == GRB_OPTIMAL ||
+        model->get(GRB_IntAttr_Status) == GRB_USER_OBJ_LIMIT)
     {
         this->solution_status = AT_OPTIMUM;
 
@@ -493,7 +428,8 @@ int CompactWCMModel::save_optimization_status()
     }
     else if (model->get(GRB_IntAttr_Status) == GRB_TIME_LIMIT)
     {
-        this->solution_dualbound = model->get(GRB_DoubleAttr_ObjBound);
+        this->solution_dualbound = min(model->get(GRB_DoubleAttr_ObjBound),
+                                       objective_upper_bound);
 
         if (model->get(GRB_IntAttr_SolCount) > 0)
         {
@@ -551,11 +487,11 @@ void CompactWCMModel::fill_solution_vectors()
 
     for (long u = 0; u < num_vertices; ++u)
     {
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long v = instance->graph->adj_pairs[2*k];
+            long e = instance->graph->adj_pairs[2*k + 1];
 
             long v_to_u_arc_idx = instance->graph->t.at(e) == u ? e : e+num_edges;
 
@@ -643,11 +579,11 @@ bool CompactWCMModel::solve_lp_relax(bool logging, double time_limit)
 
                 for (long u = 0; u < num_vertices; ++u)
                 {
-                    for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-                         it != instance->graph->adj_list.at(u).end(); ++it)
+                    for (long k = instance->graph->adj_offset[u];
+                         k < instance->graph->adj_offset[u+1]; ++k)
                     {
-                        long v = *it;
-                        long e = instance->graph->index_matrix[u][v];
+                        long v = instance->graph->adj_pairs[2*k];
+                        long e = instance->graph->adj_pairs[2*k + 1];
 
                         long v_to_u_arc_idx = instance->graph->t.at(e) == u ? e : e+num_edges;
 
@@ -748,6 +684,37 @@ bool CompactWCMModel::solve_lp_relax(bool logging, double time_limit)
     }
 }
 
+bool CompactWCMModel::set_mip_start(const vector<bool> &edge_in_solution)
+{
+    /***
+     * Provide a (connected matching) solution as a partial MIP start: only x
+     * is given, and gurobi completes the arc and flow variables.
+     */
+
+    try
+    {
+        for (long e = 0; e < num_edges; ++e)
+            x[e].set(GRB_DoubleAttr_Start, edge_in_solution[e] ? 1.0 : 0.0);
+
+        model->update();
+        return true;
+    }
+    catch(GRBException e)
+    {
+        cout << "Error setting MIP start, code = " << e.getErrorCode() << endl;
+        cout << e.getMessage() << endl;
+        return false;
+    }
+}
+
+void CompactWCMModel::set_objective_upper_bound(double bound)
+{
+    /// stop as soon as a solution reaches a known upper bound on the optimum
+
+    this->objective_upper_bound = bound;
+    model->set(GRB_DoubleParam_BestObjStop, bound);
+}
+
 void CompactWCMModel::set_time_limit(double tl)
 {
     model->set(GRB_DoubleParam_TimeLimit, tl);
@@ -760,6 +727,9 @@ double CompactWCMModel::get_mip_runtime()
 
 double CompactWCMModel::get_mip_gap()
 {
+    if (model->get(GRB_IntAttr_Status) == GRB_USER_OBJ_LIMIT)
+        return 0;
+
     return model->get(GRB_DoubleAttr_MIPGap);
 }
 
@@ -767,3 +737,21 @@ long CompactWCMModel::get_mip_num_nodes()
 {
     return model->get(GRB_DoubleAttr_NodeCount);
 }
+
+void CompactWCMModel::save_json_info(IO *record)
+{
+    /// save lp relaxation and mip info in the given json record
+
+    record->save_json_field("formulation", string("compact"));
+
+    record->save_json_field("lp_bound", lp_bound);
+    record->save_json_field("lp_runtime", lp_runtime);
+
+    record->save_json_field("status", string(solution_status == AT_OPTIMUM ?
+                                               "OPTIMAL" : "UNKNOWN"));
+    record->save_json_field("mip_primal_bound", solution_weight);
+    record->save_json_field("mip_dual_bound", solution_dualbound);
+    record->save_json_field("mip_gap", get_mip_gap());
+    record->save_json_field("mip_nodes", get_mip_num_nodes());
+    record->save_json_field("mip_runtime", get_mip_runtime());
+}
@@ -26,7 +26,7 @@
 class CompactWCMModel
 {
 public:
-    CompactWCMModel(IO*);
+    CompactWCMModel(IO*, GRBEnv* = NULL);
     virtual ~CompactWCMModel();
 
     int solve(bool);
@@ -42,16 +42,22 @@ public:
     double lp_runtime;
 
     void set_time_limit(double);
+    bool set_mip_start(const vector<bool> &);
+    void set_objective_upper_bound(double);
+    double objective_upper_bound;
 
     // further info methods
     double get_mip_runtime();
     double get_mip_gap();
     long get_mip_num_nodes();
 
+    void save_json_info(IO*);
+
 protected:
     IO *instance;
 
     GRBEnv *env;
+    bool owns_env;
     GRBModel *model;
     GRBVar *x;
     GRBVar *y;
@@ -69,7 +75,6 @@ protected:
     void fill_solution_vectors();
 
     bool check_solution();
-    void dfs_to_tag_component(long, vector<bool>&);
 };
 
 #endif
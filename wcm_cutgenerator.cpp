@@ -1,4 +1,5 @@
 #include "wcm_cutgenerator.h"
+#include "wcm_lns.h"
 
 /// algorithm setup switches
 
@@ -9,12 +10,58 @@ bool SEPARATE_INDEGREE = true;
 bool MSI_STRATEGY_FIRST_CUT_BELOW_ROOT = true;
 bool MSI_FROM_INTEGER_POINTS_ONLY = false;
 
+// at integer points, MSI between every pair of components of the subgraph
+// induced by vertices at one, up to this many (0 for no limit)
+const long MSI_INTEGRAL_MAX_CUTS = 100;
+
+// max flows of MSI separation at fractional points on a pool of threads (0 for
+// as many as the gurobi Threads parameter allows, which also caps a positive
+// value), as long as each one gets enough source vertices
+bool MSI_PARALLEL_FLOWS = true;
+const long MSI_FLOW_THREADS = 0;
+const long MSI_MIN_VERTICES_PER_THREAD = 100;
+
+// max flows of MSI separation with the in-tree CSR push-relabel kernel (see
+// WCMMaxFlow) instead of LEMON, optionally running both on every (s,t) pair to
+// compare them (the cuts are those of the selected one). LEMON remains the
+// default until the benchmark shows no disagreements and a speedup
+bool MSI_CSR_MAX_FLOW = false;
+bool MSI_MAX_FLOW_BENCHMARK = false;
+
 bool BLOSSOM_AT_ROOT_ONLY = false;
 bool BLOSSOM_HEURISTIC_SEPARATION = true;
 
+// exact BI separation: cut tree on the support graph of fractional edges only
+// (Letchford, Reinelt & Theis) instead of the whole graph (Padberg & Rao), and
+// optionally run both on every point to compare them (the fractional support
+// cuts are the ones added). Padberg & Rao remains the default until the
+// benchmark has been run and reported
+bool BLOSSOM_EXACT_ON_FRACTIONAL_SUPPORT = false;
+bool BLOSSOM_EXACT_BENCHMARK = false;
+
+// build the cut trees of exact BI separation with Gusfield's algorithm on a
+// pool of threads (0 for as many as the gurobi Threads parameter allows, which
+// also caps a positive value): gurobi threads are mostly idle while the
+// callback runs
+bool BLOSSOM_PARALLEL_CUT_TREE = true;
+const long BLOSSOM_CUT_TREE_THREADS = 0;
+
 bool INDEGREE_AT_ROOT_ONLY = true;
 bool MSI_ONLY_IF_NO_INDEGREE = false;
 
+// lp rounding heuristic at MIP nodes: in every root relaxation round until it
+// fails a few times, then spaced by a number of nodes that doubles after each
+// call not improving the incumbent, and is reset after one that does
+bool LP_ROUNDING_HEURISTIC = true;
+const long LP_ROUNDING_ROOT_FAILURES = 3;
+const double LP_ROUNDING_MIN_INTERVAL = 10;
+const double LP_ROUNDING_MAX_INTERVAL = 10000;
+const double LP_ROUNDING_EPSILON = 1e-6;
+
+// repair integer solutions violating some MSI (keeping the heaviest connected
+// part), improve them by local search, and post them as heuristic solutions
+bool MIPSOL_REPAIR_HEURISTIC = true;
+
 // clean any bits beyond the corresponding precision to avoid numerical errors?
 // (at most 14, since gurobi does not support long double yet...)
 // NB! THIS OPTION MIGHT RISK MISSING A VIOLATED INEQUALITY
@@ -87,6 +134,36 @@ bool inline check_integrality(double *point, long dim)
     return true;
 }
 
+long inline capped_threads(long requested, long cap)
+{
+    /// threads of a separation pool: as requested, but at most cap (0 for cap)
+
+    if (requested < 1 || requested > cap)
+        return cap;
+
+    return requested;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/// clocks for separation statistics, in seconds
+
+double inline wall_clock()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+double inline thread_cpu_clock()
+{
+    // NB! gurobi threads keep running during callbacks, so process cpu time
+    // would not reflect the separation effort
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 WCMCutGenerator::WCMCutGenerator(GRBModel *model, GRBVar *x_vars, GRBVar *y_vars, IO *instance)
@@ -106,6 +183,102 @@ WCMCutGenerator::WCMCutGenerator(GRBModel *model, GRBVar *x_vars, GRBVar *y_vars
     this->indegree_counter = 0;
     this->minimal_separators_counter = 0;
     this->msi_next_source = 0;
+    this->msi_found_in_round = 0;
+    this->msi_first_source = 0;
+
+    this->primal_heuristic = NULL;
+    this->rounding_calls = 0;
+    this->rounding_improvements = 0;
+    this->rounding_root_failures = 0;
+    this->rounding_interval = LP_ROUNDING_MIN_INTERVAL;
+    this->rounding_next_node = 0;
+    this->repair_calls = 0;
+    this->repair_improvements = 0;
+
+    this->lns = NULL;
+    this->lns_solutions_used = 0;
+    this->stop_flag = NULL;
+
+    if (LP_ROUNDING_HEURISTIC || MIPSOL_REPAIR_HEURISTIC)
+        this->primal_heuristic = new WCMHeuristic(instance);
+
+    // the callback runs while the other solver threads wait, so separation
+    // pools use at most as many threads as the model (NB! set in the env, e.g.
+    // by the decomposition or the lns, before the model is created)
+    this->solver_threads = model->getEnv().get(GRB_IntParam_Threads);
+    if (solver_threads < 1)
+        solver_threads = std::thread::hardware_concurrency();
+    if (solver_threads < 1)
+        solver_threads = 1;
+
+    /***
+     * Auxiliary network to separate MSI from fractional points, in CSR format
+     * and/or using LEMON. Each vertex corresponds to at most 2 nodes, so the
+     * 2n nodes of the LEMON digraph are created only once, and each call only
+     * replaces the arcs. Each thread re-targets a single max-flow workspace to
+     * every (s,t) pair it tries.
+     */
+
+    this->msi_network = NULL;
+    this->msi_network_capacity = NULL;
+    this->msi_network_snapshot = NULL;
+    this->msi_csr_network = NULL;
+    this->msi_num_threads = 1;
+    if (MSI_PARALLEL_FLOWS)
+        msi_num_threads = min(capped_threads(MSI_FLOW_THREADS, solver_threads),
+                              1 + this->num_vertices / MSI_MIN_VERTICES_PER_THREAD);
+
+    if (SEPARATE_MSI && num_vertices > 0 &&
+        (!MSI_CSR_MAX_FLOW || MSI_MAX_FLOW_BENCHMARK))
+    {
+        this->msi_network = new SmartDigraph();
+        msi_network->reserveNode(2 * this->num_vertices);
+        msi_network->reserveArc(this->num_vertices + 2 * this->num_edges);
+
+        this->msi_network_nodes.reserve(2 * this->num_vertices);
+        for (long i = 0; i < 2 * num_vertices; ++i)
+            msi_network_nodes.push_back(msi_network->addNode());
+
+        // arcs added after this snapshot are removed at the next call
+        this->msi_network_snapshot = new SmartDigraph::Snapshot(*msi_network);
+
+        this->msi_network_capacity = new SmartDigraph::ArcMap<double>(*msi_network);
+
+        // workspaces of all threads, allocated (with their maps registered in
+        // the network) here rather than in those threads
+        for (long i = 0; i < msi_num_threads; ++i)
+        {
+            MSIMaxFlow *flow = new MSIMaxFlow(*msi_network,
+                                              *msi_network_capacity,
+                                              msi_network_nodes[0],
+                                              msi_network_nodes[1]);
+            flow->init();
+            msi_preflows.push_back(flow);
+        }
+    }
+
+    if (SEPARATE_MSI && num_vertices > 0 &&
+        (MSI_CSR_MAX_FLOW || MSI_MAX_FLOW_BENCHMARK))
+    {
+        this->msi_csr_network = new WCMFlowNetwork();
+
+        for (long i = 0; i < msi_num_threads; ++i)
+            msi_csr_flows.push_back(new WCMMaxFlow(*msi_csr_network));
+    }
+
+    this->msi_flow_benchmark = vector<MaxFlowBenchmark>(msi_num_threads);
+
+    // the pool of threads trying (s,t) pairs is started only once
+    this->msi_round = 0;
+    this->msi_workers_done = 0;
+    this->msi_shutting_down = false;
+    this->msi_round_D_idx = NULL;
+    this->msi_found = vector< vector<MSIPairCut> >(msi_num_threads);
+
+    if (SEPARATE_MSI)
+        for (long i = 1; i < msi_num_threads; ++i)
+            msi_workers.push_back(std::thread(&WCMCutGenerator::msi_pool_worker,
+                                              this, i));
 
     /***
      * Support graph (using LEMON) to separate blossom inequalities (BI)
@@ -113,43 +286,117 @@ WCMCutGenerator::WCMCutGenerator(GRBModel *model, GRBVar *x_vars, GRBVar *y_vars
      * capacities from the current relaxation values.
      */
 
-    this->bi_support_graph = new ListGraph();
+    this->bi_support_graph = new SmartGraph();
     this->bi_support_vertices.reserve(this->num_vertices + 1);
     this->bi_support_edges.reserve(this->num_edges + this->num_vertices);
     this->bi_support_capacity = NULL;
+    this->bi_cut_tree = NULL;
+    this->bi_parallel_cut_tree = NULL;
+    this->bi_frac_graph = NULL;
+    this->bi_frac_capacity = NULL;
+    this->bi_frac_cut_tree = NULL;
+    this->bi_frac_parallel_cut_tree = NULL;
+
+    // exact BI separation on the whole support graph and/or on the fractional
+    // support only, according to the switches
+    const bool bi_whole_support = (!BLOSSOM_EXACT_ON_FRACTIONAL_SUPPORT ||
+                                   BLOSSOM_EXACT_BENCHMARK);
+    const bool bi_fractional_support = (BLOSSOM_EXACT_ON_FRACTIONAL_SUPPORT ||
+                                        BLOSSOM_EXACT_BENCHMARK);
 
     if (SEPARATE_BLOSSOM)
     {
-        // n vertices from instance graph, plus an artificial/dummy universal one
+        // n vertices and m edges from the instance graph (array-backed, with
+        // ids matching the original indices), plus an artificial/dummy vertex
+        instance->graph->build_smart_graph(*bi_support_graph, 1);
+        bi_support_graph->reserveEdge(this->num_edges + this->num_vertices);
+
         for (long i=0; i < num_vertices+1; ++i)
-            bi_support_vertices.push_back(bi_support_graph->addNode());
+            bi_support_vertices.push_back(bi_support_graph->nodeFromId(i));
 
-        // m edges as in the instance graph, plus one from dummy to each vertex
         for (long idx=0; idx<num_edges; ++idx)
-        {
-            long v1 = instance->graph->s.at(idx);
-            long v2 = instance->graph->t.at(idx);
-            ListGraph::Edge e = bi_support_graph->addEdge(bi_support_vertices.at(v1),
-                                                          bi_support_vertices.at(v2));
-            bi_support_edges.push_back(e);
-        }
+            bi_support_edges.push_back(bi_support_graph->edgeFromId(idx));
 
+        // one more edge from the dummy to each vertex
         for (long idx=0; idx<num_vertices; ++idx)
         {
             long v1 = num_vertices;  // dummy vertex
             long v2 = idx;
-            ListGraph::Edge e = bi_support_graph->addEdge(bi_support_vertices.at(v1),
-                                                          bi_support_vertices.at(v2));
+            SmartGraph::Edge e = bi_support_graph->addEdge(bi_support_vertices.at(v1),
+                                                           bi_support_vertices.at(v2));
             bi_support_edges.push_back(e);
         }
+
+        // capacities are refreshed at each call, but the maps and the cut tree
+        // structures (bound to the support graph) are allocated only once
+        this->bi_support_capacity = new SmartGraph::EdgeMap<double>(*bi_support_graph);
+        if (bi_whole_support && BLOSSOM_PARALLEL_CUT_TREE)
+            this->bi_parallel_cut_tree = new WCMCutTree(*bi_support_graph,
+                                                        *bi_support_capacity,
+                                                        capped_threads(BLOSSOM_CUT_TREE_THREADS,
+                                                                       solver_threads));
+        else if (bi_whole_support)
+            this->bi_cut_tree = new BICutTree(*bi_support_graph, *bi_support_capacity);
+
+        this->bi_support_node_vertex.reserve(this->num_vertices + 1);
+        for (long i=0; i < num_vertices; ++i)
+            bi_support_node_vertex.push_back(i);
+        bi_support_node_vertex.push_back(-1);   // dummy vertex
+
+        this->bi_handle_vertices.reserve(this->num_vertices);
+        this->bi_handle_mask = vector<bool>(this->num_vertices, false);
+
+        // the fractional support graph is rebuilt at each call, within the
+        // capacity of the whole support graph (its maps follow the changes)
+        if (bi_fractional_support)
+        {
+            this->bi_frac_graph = new SmartGraph();
+            bi_frac_graph->reserveNode(this->num_vertices + 1);
+            bi_frac_graph->reserveEdge(this->num_edges + this->num_vertices);
+            this->bi_frac_vertices.reserve(this->num_vertices + 1);
+            this->bi_frac_node = vector<long>(this->num_vertices, -1);
+
+            this->bi_frac_capacity = new SmartGraph::EdgeMap<double>(*bi_frac_graph);
+            if (BLOSSOM_PARALLEL_CUT_TREE)
+                this->bi_frac_parallel_cut_tree = new WCMCutTree(*bi_frac_graph,
+                                                                 *bi_frac_capacity,
+                                                                 capped_threads(BLOSSOM_CUT_TREE_THREADS,
+                                                                                solver_threads));
+            else
+                this->bi_frac_cut_tree = new BICutTree(*bi_frac_graph, *bi_frac_capacity);
+        }
     }
 }
 
 WCMCutGenerator::~WCMCutGenerator()
 {
+    {
+        std::lock_guard<std::mutex> lock(msi_pool_mutex);
+        msi_shutting_down = true;
+    }
+    msi_round_started.notify_all();
+    for (std::thread &t : msi_workers)
+        t.join();
+
     this->bi_support_vertices.clear();
     this->bi_support_edges.clear();
+    delete bi_cut_tree;
+    delete bi_parallel_cut_tree;
+    delete bi_support_capacity;
     delete bi_support_graph;
+    delete bi_frac_cut_tree;
+    delete bi_frac_parallel_cut_tree;
+    delete bi_frac_capacity;
+    delete bi_frac_graph;
+    for (MSIMaxFlow *flow : msi_preflows)
+        delete flow;
+    for (WCMMaxFlow *flow : msi_csr_flows)
+        delete flow;
+    delete msi_csr_network;
+    delete msi_network_capacity;
+    delete msi_network_snapshot;
+    delete msi_network;
+    delete primal_heuristic;
 }
 
 void WCMCutGenerator::callback()
@@ -157,11 +404,20 @@ void WCMCutGenerator::callback()
     /***
      * The actual callback method within the solver, searching for and adding 
      * dynamically the most violated (if any) indegree inequality, minimal 
-     * separator inequality (MSI), and/or blossom inequality.
+     * separator inequality (MSI), and/or blossom inequality. At MIP nodes,
+     * the relaxation solution also guides a rounding heuristic, and new
+     * incumbents cut off by lazy constraints are repaired.
      */
 
     try
     {
+        // stop requested from another thread (see WCMModel::set_stop_flag)
+        if (stop_flag && *stop_flag)
+        {
+            abort();
+            return;
+        }
+
         // callback from the search at a given MIP node - may include USER CUTS
         if (where == GRB_CB_MIPNODE)
         {
@@ -207,6 +463,12 @@ void WCMCutGenerator::callback()
                 }
             }
 
+            if (LP_ROUNDING_HEURISTIC)
+                run_lp_rounding();
+
+            if (lns)
+                post_lns_improvement();
+
             delete[] x_val;
             delete[] y_val;
         }
@@ -223,8 +485,16 @@ void WCMCutGenerator::callback()
                 if (CLEAN_VARS_BEYOND_PRECISION)
                     clean_vars_beyond_precision(SEPARATION_PRECISION);
 
-                run_minimal_separators_separation(ADD_LAZY_CNTRS);
+                bool rejected = run_minimal_separators_separation(ADD_LAZY_CNTRS);
+
+                if (rejected && MIPSOL_REPAIR_HEURISTIC)
+                    run_solution_repair();
+
+                if (!rejected && lns)
+                    offer_lns_incumbent();
             }
+            else if (lns)
+                offer_lns_incumbent();
 
             delete[] y_val;
         }
@@ -328,11 +598,41 @@ void WCMCutGenerator::clean_vars_beyond_precision(int precision)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void inline WCMCutGenerator::record_separation_round(SeparationStats &stats,
+                                                     long num_found,
+                                                     long num_cuts,
+                                                     int kind_of_cut,
+                                                     double wall_start,
+                                                     double cpu_start)
+{
+    /***
+     * Update statistics after one call to a separation procedure, which found
+     * num_found violated inequalities and added num_cuts of them.
+     */
+
+    stats.rounds++;
+    stats.found += num_found;
+
+    if (kind_of_cut == ADD_USER_CUTS)
+        stats.added_as_user_cuts += num_cuts;
+    else if (kind_of_cut == ADD_LAZY_CNTRS)
+        stats.added_as_lazy += num_cuts;
+    else // kind_of_cut == ADD_STD_CNTRS
+        stats.added_to_lp += num_cuts;
+
+    stats.wall_time += wall_clock() - wall_start;
+    stats.cpu_time += thread_cpu_clock() - cpu_start;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 bool WCMCutGenerator::run_blossom_separation(int kind_of_cut)
 {
     /// wrapper for the separation procedure to suit different execution contexts
 
     bool model_updated = false;
+    const double wall_start = wall_clock();
+    const double cpu_start = thread_cpu_clock();
 
     // eventual cuts are stored here
     vector<GRBLinExpr> cuts_lhs = vector<GRBLinExpr>();
@@ -341,6 +641,12 @@ bool WCMCutGenerator::run_blossom_separation(int kind_of_cut)
     if (BLOSSOM_HEURISTIC_SEPARATION)
         // heuristic separation = attempt to find a violated BI quickly, but might fail - runtime in O(n + m)
         model_updated = separate_blossom_heuristically(cuts_lhs, cuts_rhs);
+    else if (BLOSSOM_EXACT_BENCHMARK)
+        // both exact separation procedures below, on the same point
+        model_updated = benchmark_blossom_exactly(cuts_lhs, cuts_rhs);
+    else if (BLOSSOM_EXACT_ON_FRACTIONAL_SUPPORT)
+        // exact separation with a cut tree over the k vertices incident to fractional edges only
+        model_updated = separate_blossom_on_fractional_support(cuts_lhs, cuts_rhs);
     else
         // exact separation = either find a violated BI, or decide that none exists - runtime in O(n^3 \sqrt(m))
         model_updated = separate_blossom_exactly(cuts_lhs, cuts_rhs);
@@ -363,6 +669,9 @@ bool WCMCutGenerator::run_blossom_separation(int kind_of_cut)
         }
     }
 
+    record_separation_round(blossom_stats, cuts_lhs.size(), cuts_lhs.size(), kind_of_cut,
+                            wall_start, cpu_start);
+
     return model_updated;
 }
 
@@ -377,12 +686,10 @@ bool WCMCutGenerator::separate_blossom_exactly(vector<GRBLinExpr> &cuts_lhs,
 
     // 1. DETERMINE UPDATED EDGE CAPACITIES FROM THE CURRENT RELAXATION
 
-    bi_support_capacity = new ListGraph::EdgeMap<double>(*bi_support_graph);
-
     // edge uv from the instance graph: capacity[uv] = x*_uv
     for (long idx=0; idx < num_edges; ++idx)
     {
-        ListGraph::Edge edge = bi_support_edges.at(idx);
+        SmartGraph::Edge edge = bi_support_edges.at(idx);
         (*bi_support_capacity)[edge] = x_val[idx];
     }
 
@@ -391,7 +698,7 @@ bool WCMCutGenerator::separate_blossom_exactly(vector<GRBLinExpr> &cuts_lhs,
     for (long idx=0; idx < num_vertices; ++idx)
     {
         long dummy_edge_idx = num_edges + idx;
-        ListGraph::Edge edge = bi_support_edges.at(dummy_edge_idx);
+        SmartGraph::Edge edge = bi_support_edges.at(dummy_edge_idx);
 
         // y_u is the sum of x_uv for v neighbours of u
         (*bi_support_capacity)[edge] = 1.0 - y_val[idx];
@@ -400,106 +707,221 @@ bool WCMCutGenerator::separate_blossom_exactly(vector<GRBLinExpr> &cuts_lhs,
     // 2. CONSTRUCT GOMORY-HU CUT TREE OF THE SUPPORT GRAPH
 
     // this is the runtime bottleneck: O(n^3 sqrt(m)) in this implementation
-    GomoryHu<ListGraph, ListGraph::EdgeMap<double> > cut_tree(*bi_support_graph,
-                                                              *bi_support_capacity);
-    cut_tree.run();
+    // (NB! the cut tree object reads the capacity map updated above)
+    if (bi_parallel_cut_tree)
+        bi_parallel_cut_tree->run();
+    else
+        bi_cut_tree->run();
 
     // 3. LOOK FOR VIOLATED BI FROM MIN-CUT VALUES AT EACH EDGE IN THE CUT TREE
+    if (bi_parallel_cut_tree)
+        bi_cuts_from_cut_tree(*bi_support_graph,
+                              *bi_parallel_cut_tree,
+                              bi_support_node_vertex,
+                              cuts_lhs,
+                              cuts_rhs);
+    else
+        bi_cuts_from_cut_tree(*bi_support_graph,
+                              *bi_cut_tree,
+                              bi_support_node_vertex,
+                              cuts_lhs,
+                              cuts_rhs);
 
-    ListGraph::Node dummy = bi_support_vertices.back();
+    return (cuts_lhs.size() > 0);
+}
 
-    // 3.1 TRAVERSE CUT TREE EDGES BY QUERYING THE PREDECESSOR OF EACH VERTEX (EXCEPT THE ROOT) 
-    for (long idx=0; idx<num_vertices+1; ++idx)
+bool WCMCutGenerator::separate_blossom_on_fractional_support(vector<GRBLinExpr> &cuts_lhs,
+                                                             vector<long> &cuts_rhs)
+{
+    /***
+     * Exact separation in the spirit of "Odd minimum cut sets and b-matchings
+     * revisited", 2008, by [Letchford, Reinelt, Theis]: the cut tree is built
+     * only over vertices incident to fractional edges (plus the dummy).
+     *
+     * Since y_u = \sum_{v neighbour of u} x_uv, an edge with x_uv = 1 is an
+     * isolated component of the support of x, and so is a vertex with y_u = 0.
+     * The cut value of a handle H is |H| - 2x(E(H)), summed over its parts in
+     * each component of the support. If H is odd, so is some part, whose cut
+     * value is then at most that of H. Odd parts within x=1 edges or isolated
+     * vertices have cut value 1, so a violated BI exists iff one exists with
+     * its handle inside a component of the fractional edges. Removing x=0
+     * edges and the remaining vertices leaves all these cut values unchanged.
+     */
+
+    // 1. BUILD THE SUPPORT GRAPH OF FRACTIONAL EDGES, WITH THE DUMMY VERTEX
+
+    for (long vertex_id : bi_frac_vertices)
+        if (vertex_id >= 0)
+            bi_frac_node[vertex_id] = -1;
+
+    bi_frac_graph->clear();
+    bi_frac_vertices.clear();
+
+    for (long idx=0; idx < num_edges; ++idx)
     {
-        ListGraph::Node s = bi_support_vertices.at(idx);
-        ListGraph::Node t = cut_tree.predNode(s);
-        if(t != INVALID)   // not the cut tree root (n+1 vertices => n edges)
+        if (x_val[idx] > MSI_ZERO && x_val[idx] < MSI_ONE)
         {
-            // 3.2 MINCUT INDUCED BY THIS EDGE OF THE CUT TREE MAY GIVE A VIOLATED
-            // BI IF ITS VALUE IS < 1 AND ONE OF THE CUTSETS IS OF ODD CARDINALITY 
-            if (cut_tree.predValue(s) < MSI_ONE)
-            {
-                // 3.2 SIDE 1: HANDLE INDUCED BY THE CUTSET CONTAINING S
-                bool cutset_with_s = true;
-                long cutset_size = 0;
-                vector<long> cutset_vertices = vector<long>();
-                vector<bool> cutset_mask = vector<bool>(num_vertices, false);
+            long v1 = instance->graph->s.at(idx);
+            long v2 = instance->graph->t.at(idx);
 
-                for(GomoryHu<ListGraph, ListGraph::EdgeMap<double> >::MinCutNodeIt it(cut_tree, s, t, cutset_with_s); it != INVALID; ++it)
+            for (long v : {v1, v2})
+            {
+                if (bi_frac_node[v] < 0)
                 {
-                    // ignore the dummy vertex
-                    long vertex_id = bi_support_graph->id(it);
-                    if (vertex_id != bi_support_graph->id(dummy))
-                    {
-                        ++cutset_size;
-                        cutset_vertices.push_back(vertex_id);
-                        cutset_mask.at(vertex_id) = true;
-                    }
+                    bi_frac_node[v] = bi_frac_graph->id(bi_frac_graph->addNode());
+                    bi_frac_vertices.push_back(v);
                 }
+            }
 
-                if (cutset_size % 2 == 1)
-                {
-                    long bi_rhs = (cutset_size - 1) / 2;
+            SmartGraph::Edge e = bi_frac_graph->addEdge(bi_frac_graph->nodeFromId(bi_frac_node[v1]),
+                                                        bi_frac_graph->nodeFromId(bi_frac_node[v2]));
+            (*bi_frac_capacity)[e] = x_val[idx];
+        }
+    }
 
-                    // determine edges with both endpoints in the cutset and check for violation
-                    GRBLinExpr violated_constr = 0;
-                    double current_lhs = bi_lhs_from_handle(cutset_vertices, cutset_mask, violated_constr);
+    // a single vertex in the handle gives a trivially satisfied BI
+    const long num_frac_vertices = bi_frac_vertices.size();
+    if (num_frac_vertices < 3)
+        return false;
 
-                    if (current_lhs > bi_rhs)
-                    {
-                        cuts_lhs.push_back(violated_constr);
-                        cuts_rhs.push_back(bi_rhs);
-                    }
+    // edge ru from the dummy to each fractional vertex: capacity[ru] = 1 - y*_u
+    SmartGraph::Node dummy = bi_frac_graph->addNode();
+    bi_frac_vertices.push_back(-1);
 
-                    #ifdef DEBUG_BI
-                        if (current_lhs > bi_rhs)
-                            cout << "### ADDED BI: (...) = " << current_lhs << " > " << bi_rhs << endl;
-                    #endif
-                }
+    for (long i=0; i < num_frac_vertices; ++i)
+    {
+        SmartGraph::Edge e = bi_frac_graph->addEdge(dummy, bi_frac_graph->nodeFromId(i));
+        (*bi_frac_capacity)[e] = 1.0 - y_val[bi_frac_vertices[i]];
+    }
 
-                // 3.2 SIDE 2: REPEAT FOR THE HANDLE INDUCED BY THE CUTSET CONTAINING T
-                cutset_with_s = false;
-                cutset_size = 0;
-                cutset_vertices.clear();
-                cutset_mask = vector<bool>(num_vertices, false);
-                for(GomoryHu<ListGraph, ListGraph::EdgeMap<double> >::MinCutNodeIt it(cut_tree, s, t, cutset_with_s); it != INVALID; ++it)
+    // 2. CONSTRUCT GOMORY-HU CUT TREE OF THE FRACTIONAL SUPPORT GRAPH
+
+    // k max flows instead of n, where k is the number of fractional vertices
+    if (bi_frac_parallel_cut_tree)
+        bi_frac_parallel_cut_tree->run();
+    else
+        bi_frac_cut_tree->run();
+
+    // 3. LOOK FOR VIOLATED BI FROM MIN-CUT VALUES AT EACH EDGE IN THE CUT TREE
+    if (bi_frac_parallel_cut_tree)
+        bi_cuts_from_cut_tree(*bi_frac_graph,
+                              *bi_frac_parallel_cut_tree,
+                              bi_frac_vertices,
+                              cuts_lhs,
+                              cuts_rhs);
+    else
+        bi_cuts_from_cut_tree(*bi_frac_graph,
+                              *bi_frac_cut_tree,
+                              bi_frac_vertices,
+                              cuts_lhs,
+                              cuts_rhs);
+
+    return (cuts_lhs.size() > 0);
+}
+
+bool WCMCutGenerator::benchmark_blossom_exactly(vector<GRBLinExpr> &cuts_lhs,
+                                                vector<long> &cuts_rhs)
+{
+    /***
+     * Run both exact separation procedures on the current point, recording
+     * their running times and findings. Only the cuts from the fractional
+     * support are returned.
+     */
+
+    vector<GRBLinExpr> padberg_rao_lhs = vector<GRBLinExpr>();
+    vector<long> padberg_rao_rhs = vector<long>();
+
+    double start = wall_clock();
+    bool padberg_rao_found = separate_blossom_exactly(padberg_rao_lhs,
+                                                      padberg_rao_rhs);
+    double middle = wall_clock();
+    bool fractional_found = separate_blossom_on_fractional_support(cuts_lhs,
+                                                                   cuts_rhs);
+    double end = wall_clock();
+
+    blossom_benchmark.points++;
+    blossom_benchmark.padberg_rao_found += padberg_rao_lhs.size();
+    blossom_benchmark.fractional_found += cuts_lhs.size();
+    blossom_benchmark.padberg_rao_time += middle - start;
+    blossom_benchmark.fractional_time += end - middle;
+
+    if (padberg_rao_found != fractional_found)
+        blossom_benchmark.disagreements++;
+
+    return fractional_found;
+}
+
+template <class CutTree>
+void WCMCutGenerator::bi_cuts_from_cut_tree(SmartGraph &graph,
+                                            CutTree &cut_tree,
+                                            vector<long> &node_vertex,
+                                            vector<GRBLinExpr> &cuts_lhs,
+                                            vector<long> &cuts_rhs)
+{
+    /***
+     * Inspects the min cut induced by each edge of a cut tree over the given
+     * support graph, where node_vertex maps node ids to vertices of the
+     * instance (-1 for the dummy vertex), and stores the violated BI found.
+     * CutTree is either lemon::GomoryHu or WCMCutTree.
+     */
+
+    // 3.1 TRAVERSE CUT TREE EDGES BY QUERYING THE PREDECESSOR OF EACH VERTEX (EXCEPT THE ROOT) 
+    for (SmartGraph::NodeIt s(graph); s != INVALID; ++s)
+    {
+        SmartGraph::Node t = cut_tree.predNode(s);
+        if(t != INVALID)   // not the cut tree root (k+1 vertices => k edges)
+        {
+            // 3.2 MINCUT INDUCED BY THIS EDGE OF THE CUT TREE MAY GIVE A VIOLATED
+            // BI IF ITS VALUE IS < 1 AND ONE OF THE CUTSETS IS OF ODD CARDINALITY 
+            if (cut_tree.predValue(s) < MSI_ONE)
+            {
+                // SIDE 1: HANDLE INDUCED BY THE CUTSET CONTAINING S
+                // SIDE 2: REPEAT FOR THE HANDLE INDUCED BY THE CUTSET CONTAINING T
+                for (bool cutset_with_s : {true, false})
                 {
-                    // ignore the dummy vertex
-                    long vertex_id = bi_support_graph->id(it);
-                    if (vertex_id != bi_support_graph->id(dummy))
+                    // handle vertices, ignoring the dummy
+                    bi_handle_vertices.clear();
+                    for (typename CutTree::MinCutNodeIt it(cut_tree, s, t, cutset_with_s); it != INVALID; ++it)
                     {
-                        ++cutset_size;
-                        cutset_vertices.push_back(vertex_id);
-                        cutset_mask.at(vertex_id) = true;
+                        long vertex_id = node_vertex[graph.id(it)];
+                        if (vertex_id >= 0)
+                        {
+                            bi_handle_vertices.push_back(vertex_id);
+                            bi_handle_mask[vertex_id] = true;
+                        }
                     }
-                }
-
-                if (cutset_size % 2 == 1)
-                {
-                    long bi_rhs = (cutset_size - 1) / 2;
 
-                    // determine edges with both endpoints in the cutset and check for violation
-                    GRBLinExpr violated_constr = 0;
-                    double current_lhs = bi_lhs_from_handle(cutset_vertices, cutset_mask, violated_constr);
+                    long cutset_size = bi_handle_vertices.size();
 
-                    if (current_lhs > bi_rhs)
+                    if (cutset_size % 2 == 1)
                     {
-                        cuts_lhs.push_back(violated_constr);
-                        cuts_rhs.push_back(bi_rhs);
-                    }
+                        long bi_rhs = (cutset_size - 1) / 2;
+
+                        // determine edges with both endpoints in the cutset and check for violation
+                        GRBLinExpr violated_constr = 0;
+                        double current_lhs = bi_lhs_from_handle(bi_handle_vertices,
+                                                                bi_handle_mask,
+                                                                violated_constr);
 
-                    #ifdef DEBUG_BI
                         if (current_lhs > bi_rhs)
-                            cout << "### ADDED BI: (...) = " << current_lhs << " > " << bi_rhs << endl;
-                    #endif
+                        {
+                            cuts_lhs.push_back(violated_constr);
+                            cuts_rhs.push_back(bi_rhs);
+                        }
+
+                        #ifdef DEBUG_BI
+                            if (current_lhs > bi_rhs)
+                                cout << "### ADDED BI: (...) = " << current_lhs << " > " << bi_rhs << endl;
+                        #endif
+                    }
+
+                    // reset only the mask entries set for this handle
+                    for (long vertex_id : bi_handle_vertices)
+                        bi_handle_mask[vertex_id] = false;
                 }
             }
         }
     }
-
-    delete bi_support_capacity;
-
-    return (cuts_lhs.size() > 0);
 }
 
 double WCMCutGenerator::bi_lhs_from_handle(vector<long> &handle_vertices,
@@ -541,7 +963,7 @@ double WCMCutGenerator::bi_lhs_from_handle(vector<long> &handle_vertices,
             {
                 long v1 = handle_vertices.at(i);
                 long v2 = handle_vertices.at(j);
-                long edge_idx = instance->graph->index_matrix[v1][v2];
+                long edge_idx = instance->graph->edge_index(v1, v2);
                 if (edge_idx >= 0)
                 {
                     constr += (x_vars[edge_idx]);
@@ -644,11 +1066,11 @@ void inline WCMCutGenerator::dfs_from_frac_x_only(vector<bool> &edge_mask,
     component_vertices.push_back(u);
     component_mask.at(u) = true;
 
-    for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-        it != instance->graph->adj_list.at(u).end(); ++it)
+    for (long k = instance->graph->adj_offset[u];
+         k < instance->graph->adj_offset[u+1]; ++k)
     {
-        long v = *it;
-        long edge_idx = instance->graph->index_matrix[u][v];
+        long v = instance->graph->adj_pairs[2*k];
+        long edge_idx = instance->graph->adj_pairs[2*k + 1];
 
         if (edge_mask.at(edge_idx) && !seen.at(v))
         {
@@ -668,6 +1090,8 @@ bool WCMCutGenerator::run_indegree_separation(int kind_of_cut)
     /// wrapper for the separation procedure to suit different execution contexts
 
     bool model_updated = false;
+    const double wall_start = wall_clock();
+    const double cpu_start = thread_cpu_clock();
 
     // eventual cuts are stored here
     vector<GRBLinExpr> cuts_lhs = vector<GRBLinExpr>();
@@ -696,6 +1120,9 @@ bool WCMCutGenerator::run_indegree_separation(int kind_of_cut)
         }
     }
 
+    record_separation_round(indegree_stats, cuts_lhs.size(), cuts_lhs.size(), kind_of_cut,
+                            wall_start, cpu_start);
+
     return model_updated;
 }
 
@@ -745,10 +1172,13 @@ bool WCMCutGenerator::run_minimal_separators_separation(int kind_of_cut)
     /// wrapper for the separation procedure to suit different execution contexts
 
     bool model_updated = false;
+    const double wall_start = wall_clock();
+    const double cpu_start = thread_cpu_clock();
 
     // eventual cuts are stored here
     vector<GRBLinExpr> cuts_lhs = vector<GRBLinExpr>();
     vector<long> cuts_rhs = vector<long>();
+    this->msi_found_in_round = 0;
 
     if (y_integral)
     {
@@ -786,6 +1216,10 @@ bool WCMCutGenerator::run_minimal_separators_separation(int kind_of_cut)
         }
     }
 
+    record_separation_round(minimal_separators_stats, msi_found_in_round,
+                            cuts_lhs.size(), kind_of_cut,
+                            wall_start, cpu_start);
+
     return model_updated;
 }
 
@@ -794,7 +1228,10 @@ bool WCMCutGenerator::separate_minimal_separators_integral(vector<GRBLinExpr> &c
 {
     /***
      * Solve the separation problem for minimal (a,b)-separator inequalities,
-     * assuming the current point is integral
+     * assuming the current point is integral: one MSI for each pair of
+     * connected components of the subgraph induced by vertices at one (up to
+     * MSI_INTEGRAL_MAX_CUTS), so that a single round rules out this point
+     * and others keeping some of these components apart
      */
 
     vector<long> vars_at_one = vector<long>();
@@ -806,161 +1243,171 @@ bool WCMCutGenerator::separate_minimal_separators_integral(vector<GRBLinExpr> &c
     if (num_vars_at_one < 2)
         return false;
 
-    // 1. SUBGRAPH CONTAINING ONLY EDGES BETWEEN VERTICES AT ONE
-    vector< vector<long> > aux_adj_list;
+    // 1. DFS IN THE SUBGRAPH INDUCED BY VERTICES AT ONE TAGGING CONNECTED
+    // COMPONENTS, IN O(n + m) FROM THE ADJACENCY ARRAYS
+    // NB! Trying to stick to the "rotating source" strategy to avoid favouring
+    // separators between vertices of smaller index: components are numbered
+    // in the order of their first vertex at one from msi_next_source onwards
+    long first = 0;
+    while (first < num_vars_at_one && vars_at_one.at(first) < this->msi_next_source)
+        ++first;
 
-    // all vertices
-    for (long i = 0; i < num_vertices; ++i)
-        aux_adj_list.push_back(vector<long>());
+    vector<long> components = vector<long>(num_vertices, -1);
+    vector< vector<long> > component_vertices;
+    vector<long> stack;
 
-    // only edges between vertices at one
     for (long i = 0; i < num_vars_at_one; ++i)
-        for (long j = i+1; j < num_vars_at_one; ++j)
+    {
+        long root = vars_at_one.at((first + i) % num_vars_at_one);
+        if (components.at(root) >= 0)
+            continue;
+
+        const long count = component_vertices.size();
+        component_vertices.push_back(vector<long>());
+
+        components.at(root) = count;
+        stack.push_back(root);
+        while (!stack.empty())
         {
-            long u = vars_at_one.at(i);
-            long v = vars_at_one.at(j);
-            if (instance->graph->index_matrix[u][v] >= 0)
+            long u = stack.back();
+            stack.pop_back();
+            component_vertices.back().push_back(u);
+
+            for (long k = instance->graph->adj_offset[u];
+                 k < instance->graph->adj_offset[u+1]; ++k)
             {
-                // i-th vertex at one (u) adjacent to j-th one (v)
-                aux_adj_list[u].push_back(v);
-                aux_adj_list[v].push_back(u);
+                long v = instance->graph->adj_pairs[2*k];
+                if (components.at(v) < 0 && y_val[v] >= MSI_ONE)
+                {
+                    components.at(v) = count;
+                    stack.push_back(v);
+                }
             }
         }
+    }
 
-    // 2. DFS IN THIS AUXILIARY GRAPH TAGGING CONNECTED COMPONENTS
-    vector<long> components = vector<long>(num_vertices, -1);
-    check_components(aux_adj_list, components);
-
-    // 3. GET TWO VARS Y_s = Y_t = 1, WITH s AND t IN DIFFERENT COMPONENTS
-    // NB! Trying to stick to the "rotating source" strategy to avoid favouring
-    // separators between vertices of smaller index
-    long s = -1;
-    vector<long>::iterator it = vars_at_one.begin();
-    while ( it != vars_at_one.end() && s < 0)
+    const long num_components = component_vertices.size();
+    if (num_components < 2)
     {
-        long v = *it;
-        if(v >= this->msi_next_source)
-            s = v;
-
-        ++it;
+        // no two vertices at 1 in two different components... INTEGER FEASIBLE POINT!
+        return false;
     }
 
-    // msi_next_source not at 1, nor any vertex with larger index?
-    if (s < 0)
-        s = vars_at_one.front();
+    // every pair of components gives a violated MSI (before the cap below)
+    this->msi_found_in_round = num_components * (num_components - 1) / 2;
 
-    long t = -1;
-    it = vars_at_one.begin();
-    while ( it != vars_at_one.end() && t < 0)
-    {
-        long v = *it;
-        if(components.at(v) != components.at(s))
-            t = v;
+    // 2. FOR EACH COMPONENT, DETERMINE VERTICES OUTSIDE IT THAT ARE ADJACENT
+    // TO SOME VERTEX IN IT (NB! ALL AT ZERO, HENCE NOT IN OTHER COMPONENTS)
+    vector< vector<long> > component_neighbours(num_components);
+    vector<long> last_tagged = vector<long>(num_vertices, -1);
 
-        ++it;
-    }
-
-    if (t < 0)
+    for (long c = 0; c < num_components; ++c)
     {
-        // no two vertices at 1 in two different components... INTEGER FEASIBLE POINT!
-        //cout << "### no two vertices at 1 in two different components... INTEGER FEASIBLE POINT" << endl;
-        return false;
+        for (long u : component_vertices[c])
+        {
+            for (long k = instance->graph->adj_offset[u];
+                 k < instance->graph->adj_offset[u+1]; ++k)
+            {
+                long v = instance->graph->adj_pairs[2*k];
+                if (components.at(v) != c && last_tagged.at(v) != c)
+                {
+                    last_tagged.at(v) = c;
+                    component_neighbours[c].push_back(v);
+                }
+            }
+        }
     }
 
-    // 4. DETERMINE VERTICES IN V\COMPONENT[s] THAT ARE ADJACENT TO SOME VERTEX IN COMPONENT[s]
-    vector<long> separator_vertices = vector<long>();
+    // 3. ONE MSI FOR EACH PAIR OF COMPONENTS, BETWEEN THEIR FIRST VERTICES
     vector<bool> separator_mask = vector<bool>(num_vertices, false);
-    vector<bool> s_component_mask = vector<bool>(num_vertices, false);
-    for (long u=0; u < num_vertices; ++u)
+
+    for (long c = 0; c < num_components; ++c)
     {
-        if(components.at(u) == components.at(s))
-            s_component_mask.at(u) = true;
-        else
+        for (long d = c+1; d < num_components; ++d)
         {
-            bool u_is_a_neighbour = false;
-            list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-            while (it != instance->graph->adj_list.at(u).end() && !u_is_a_neighbour)
-            {
-                long v = *it;
-                if (components.at(v) == components.at(s))
-                    u_is_a_neighbour = true;
+            if (MSI_INTEGRAL_MAX_CUTS > 0 &&
+                (long) cuts_lhs.size() >= MSI_INTEGRAL_MAX_CUTS)
+                break;
 
-                ++it;
-            }
+            const long s = component_vertices[c].front();
+            const long t = component_vertices[d].front();
 
-            if (u_is_a_neighbour)
-            {
-                separator_vertices.push_back(u);
+            // 4. THE NEIGHBOURS OF THE COMPONENT OF s SEPARATE IT FROM t
+            vector<long> separator_vertices = component_neighbours[c];
+            for (long u : separator_vertices)
                 separator_mask.at(u) = true;
-            }
-        }
-    }
 
-    // 5. FOUND A SEPARATOR, BUT NOW LIFT IT TO A MINIMAL ONE
-    #ifdef DEBUG_MSI_INTEGRAL
-        cout << "### (" << s << "," << t << ")- separator"
-             << endl;
-        cout << "### before lifting: { ";
+            // 5. FOUND A SEPARATOR, BUT NOW LIFT IT TO A MINIMAL ONE
+            #ifdef DEBUG_MSI_INTEGRAL
+                cout << "### (" << s << "," << t << ")- separator"
+                     << endl;
+                cout << "### before lifting: { ";
 
-        for (vector<long>::iterator it = separator_vertices.begin();
-                                    it != separator_vertices.end(); ++it)
-            cout << *it << " ";
+                for (vector<long>::iterator it = separator_vertices.begin();
+                                            it != separator_vertices.end(); ++it)
+                    cout << *it << " ";
 
-        cout << "}" << endl;
-    #endif
+                cout << "}" << endl;
+            #endif
 
-    lift_to_minimal_separator(separator_vertices, separator_mask, s, t);
+            lift_to_minimal_separator(separator_vertices, separator_mask, s, t);
 
-    #ifdef DEBUG_MSI_INTEGRAL
-        cout << "### after lifting: { ";
+            #ifdef DEBUG_MSI_INTEGRAL
+                cout << "### after lifting: { ";
 
-        for (vector<long>::iterator it = separator_vertices.begin();
-                                    it != separator_vertices.end(); ++it)
-            cout << *it << " ";
+                for (vector<long>::iterator it = separator_vertices.begin();
+                                            it != separator_vertices.end(); ++it)
+                    cout << *it << " ";
 
-        cout << "}" << endl;
-    #endif
+                cout << "}" << endl;
+            #endif
 
-    // 6. DETERMINE INEQUALITY
+            // 6. DETERMINE INEQUALITY
 
-    GRBLinExpr violated_constr = 0;
+            GRBLinExpr violated_constr = 0;
 
-    violated_constr += y_vars[s];
-    violated_constr += y_vars[t];
+            violated_constr += y_vars[s];
+            violated_constr += y_vars[t];
 
-    vector<long>::iterator it_S = separator_vertices.begin();
-    while (it_S != separator_vertices.end())
-    {
-        violated_constr += ( (-1) * y_vars[*it_S] );
-        ++it_S;
-    }
+            vector<long>::iterator it_S = separator_vertices.begin();
+            while (it_S != separator_vertices.end())
+            {
+                violated_constr += ( (-1) * y_vars[*it_S] );
+                ++it_S;
+            }
 
-    cuts_lhs.push_back(violated_constr);
-    cuts_rhs.push_back(1);
+            cuts_lhs.push_back(violated_constr);
+            cuts_rhs.push_back(1);
 
-    #ifdef DEBUG_MSI_INTEGRAL
-        double violating_lhs = 0;
+            #ifdef DEBUG_MSI_INTEGRAL
+                double violating_lhs = 0;
 
-        cout << "### ADDED MSI: ";
-        cout << "y_" << s << " + y_" << t;
+                cout << "### ADDED MSI: ";
+                cout << "y_" << s << " + y_" << t;
 
-        violating_lhs += y_val[s];
-        violating_lhs += y_val[t];
+                violating_lhs += y_val[s];
+                violating_lhs += y_val[t];
 
-        it_S = separator_vertices.begin();
-        while (it_S != separator_vertices.end())
-        {
-            cout << " - y_" << *it_S << "";
-            violating_lhs -= y_val[*it_S];
-            ++it_S;
-        }
+                it_S = separator_vertices.begin();
+                while (it_S != separator_vertices.end())
+                {
+                    cout << " - y_" << *it_S << "";
+                    violating_lhs -= y_val[*it_S];
+                    ++it_S;
+                }
 
-        cout << " <= 1 " << endl;
-        cout << right;
-        cout << setw(80) << "(lhs at current point "
-             << violating_lhs << ")" << endl;
-        cout << left;
-    #endif
+                cout << " <= 1 " << endl;
+                cout << right;
+                cout << setw(80) << "(lhs at current point "
+                     << violating_lhs << ")" << endl;
+                cout << left;
+            #endif
+
+            // reset the mask (lifting only clears entries it removes)
+            for (long u : separator_vertices)
+                separator_mask.at(u) = false;
+        }
+    }
 
     this->msi_next_source++;
     return true;
@@ -973,11 +1420,12 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
 
     // 1. CONSTRUCT AUXILIARY NETWORK D, WITH REDUCTIONS FROM INTEGRAL VARS
 
-    // LEMON digraph representing the current solution
-    SmartDigraph D;
-    vector<SmartDigraph::Node> D_vertices;
-    map<pair<long,long>, SmartDigraph::Arc> D_arcs;
-    SmartDigraph::ArcMap<double> D_capacity(D);
+    // network representing the current solution: the 2n nodes of the LEMON
+    // digraph are kept, and only the arcs of the previous call are removed
+    if (msi_network)
+        msi_network_snapshot->restore();
+    if (msi_csr_network)
+        msi_csr_network->clear();
     long D_size = 0;
 
     vector<long> vars_at_one = vector<long>();
@@ -993,16 +1441,13 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
         const double value = y_val[u];
         if (value <= MSI_ZERO)  // == 0
         {
-            // add only one vertex u_1 = u_2 in D
-            D_vertices.push_back(D.addNode());
+            // use only one vertex u_1 = u_2 in D
             D_idx_of_vertex[u] = D_size;
             ++D_size;
         }
         else if(value > MSI_ZERO && value < MSI_ONE)   // > 0 && < 1
         {
-            // add two vertices u_1, u_2 in D
-            D_vertices.push_back(D.addNode());
-            D_vertices.push_back(D.addNode());
+            // use two vertices u_1, u_2 in D
             D_idx_of_vertex[u] = D_size;
 
             // redundant, but helps adding arcs more efficiently below
@@ -1030,7 +1475,7 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
         {
             long u = vars_at_one.at(i);
             long v = vars_at_one.at(j);
-            if (instance->graph->index_matrix[u][v] >= 0)
+            if (instance->graph->edge_index(u, v) >= 0)
             {
                 // i-th vertex at one (u) adjacent to j-th one (v)
                 aux_adj_list[i].push_back(j);
@@ -1042,10 +1487,7 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
     vector<long> components = vector<long>(num_vars_at_one, -1);
     long num_components = check_components(aux_adj_list, components);
 
-    // add one vertex in D for each component in the auxiliary graph
-    for (long i = 0; i < num_components; ++i)
-        D_vertices.push_back(D.addNode());
-
+    // use one vertex in D for each component in the auxiliary graph
     for (long i = 0; i < num_vars_at_one; ++i)
     {
         long u = vars_at_one.at(i);
@@ -1063,11 +1505,8 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
     {
         long v1 = fractional_vars_D_idx.at(idx);
         long v2 = v1 + 1;
-        pair<long,long> v1v2 = make_pair(v1,v2);
-
-        D_arcs[v1v2] = D.addArc(D_vertices[v1], D_vertices[v2]);
 
-        D_capacity[ D_arcs[v1v2] ] = fractional_vars_val.at(idx);
+        msi_add_arc(v1, v2, fractional_vars_val.at(idx));
     }
 
     // 1.4 REMAINING ARCS: UNLIMITED CAPACITY (|V|+1 SUFFICES HERE!)
@@ -1093,13 +1532,9 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
             long uu = D_idx_of_vertex[u];
             long vv = D_idx_of_vertex[v];
 
-            pair<long,long> uuvv = make_pair(uu,vv);
-            D_arcs[uuvv] = D.addArc(D_vertices[uu], D_vertices[vv]);
-            D_capacity[ D_arcs[uuvv] ] = UNLIMITED_CAPACITY;
+            msi_add_arc(uu, vv, UNLIMITED_CAPACITY);
 
-            //pair<long,long> vvuu = make_pair(vv,uu);
-            //D_arcs[vvuu] = D.addArc(D_vertices[vv], D_vertices[uu]);
-            //D_capacity[ D_arcs[vvuu] ] = UNLIMITED_CAPACITY;
+            //msi_add_arc(vv, uu, UNLIMITED_CAPACITY);
         }
         else if (y_val[u] <= MSI_ZERO && y_val[v] >= MSI_ONE)
         {
@@ -1107,13 +1542,9 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
             long uu = D_idx_of_vertex[u];
             long vv = D_idx_of_vertex[v];
 
-            pair<long,long> vvuu = make_pair(vv,uu);
-            D_arcs[vvuu] = D.addArc(D_vertices[vv], D_vertices[uu]);
-            D_capacity[ D_arcs[vvuu] ] = UNLIMITED_CAPACITY;
+            msi_add_arc(vv, uu, UNLIMITED_CAPACITY);
 
-            //pair<long,long> uuvv = make_pair(uu,vv);
-            //D_arcs[uuvv] = D.addArc(D_vertices[uu], D_vertices[vv]);
-            //D_capacity[ D_arcs[uuvv] ] = UNLIMITED_CAPACITY;
+            //msi_add_arc(uu, vv, UNLIMITED_CAPACITY);
         }
         else if (y_val[u] <= MSI_ZERO && y_val[v] > MSI_ZERO
                                       && y_val[v] < MSI_ONE)
@@ -1123,13 +1554,9 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
             //long v1 = D_idx_of_vertex[v];
             long v2 = D_idx_of_vertex[v] + 1;
 
-            pair<long,long> v2uu = make_pair(v2,uu);
-            D_arcs[v2uu] = D.addArc(D_vertices[v2], D_vertices[uu]);
-            D_capacity[ D_arcs[v2uu] ] = UNLIMITED_CAPACITY;
+            msi_add_arc(v2, uu, UNLIMITED_CAPACITY);
 
-            //pair<long,long> uuv1 = make_pair(uu,v1);
-            //D_arcs[uuv1] = D.addArc(D_vertices[uu], D_vertices[v1]);
-            //D_capacity[ D_arcs[uuv1] ] = UNLIMITED_CAPACITY;
+            //msi_add_arc(uu, v1, UNLIMITED_CAPACITY);
         }
         else if (y_val[u] > MSI_ZERO && y_val[v] <= MSI_ZERO &&
                  y_val[u] < MSI_ONE)
@@ -1139,13 +1566,9 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
             long u2 = D_idx_of_vertex[u] + 1;
             long vv = D_idx_of_vertex[v];
 
-            pair<long,long> u2vv = make_pair(u2,vv);
-            D_arcs[u2vv] = D.addArc(D_vertices[u2], D_vertices[vv]);
-            D_capacity[ D_arcs[u2vv] ] = UNLIMITED_CAPACITY;
+            msi_add_arc(u2, vv, UNLIMITED_CAPACITY);
 
-            //pair<long,long> vvu1 = make_pair(vv,u1);
-            //D_arcs[vvu1] = D.addArc(D_vertices[vv], D_vertices[u1]);
-            //D_capacity[ D_arcs[vvu1] ] = UNLIMITED_CAPACITY;
+            //msi_add_arc(vv, u1, UNLIMITED_CAPACITY);
         }
         else if (y_val[u] > MSI_ZERO && y_val[v] >= MSI_ONE &&
                  y_val[u] < MSI_ONE)
@@ -1154,14 +1577,9 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
             long u1 = D_idx_of_vertex[u];
             long u2 = D_idx_of_vertex[u] + 1;
             long vv = D_idx_of_vertex[v];
-            pair<long,long> u2vv = make_pair(u2,vv);
-            pair<long,long> vvu1 = make_pair(vv,u1);
 
-            D_arcs[u2vv] = D.addArc(D_vertices[u2], D_vertices[vv]);
-            D_arcs[vvu1] = D.addArc(D_vertices[vv], D_vertices[u1]);
-
-            D_capacity[ D_arcs[u2vv] ] = UNLIMITED_CAPACITY;
-            D_capacity[ D_arcs[vvu1] ] = UNLIMITED_CAPACITY;
+            msi_add_arc(u2, vv, UNLIMITED_CAPACITY);
+            msi_add_arc(vv, u1, UNLIMITED_CAPACITY);
         }
         else if (y_val[u] >= MSI_ONE && y_val[v] > MSI_ZERO
                                      && y_val[v] < MSI_ONE)
@@ -1170,14 +1588,9 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
             long uu = D_idx_of_vertex[u];
             long v1 = D_idx_of_vertex[v];
             long v2 = D_idx_of_vertex[v] + 1;
-            pair<long,long> v2uu = make_pair(v2,uu);
-            pair<long,long> uuv1 = make_pair(uu,v1);
-
-            D_arcs[v2uu] = D.addArc(D_vertices[v2], D_vertices[uu]);
-            D_arcs[uuv1] = D.addArc(D_vertices[uu], D_vertices[v1]);
 
-            D_capacity[ D_arcs[v2uu] ] = UNLIMITED_CAPACITY;
-            D_capacity[ D_arcs[uuv1] ] = UNLIMITED_CAPACITY;
+            msi_add_arc(v2, uu, UNLIMITED_CAPACITY);
+            msi_add_arc(uu, v1, UNLIMITED_CAPACITY);
         }
         else if (y_val[u] > MSI_ZERO && y_val[v] > MSI_ZERO &&
                  y_val[u] < MSI_ONE  && y_val[v] < MSI_ONE  )
@@ -1187,174 +1600,375 @@ bool WCMCutGenerator::separate_minimal_separators_std(vector<GRBLinExpr> &cuts_l
             long u2 = D_idx_of_vertex[u] + 1;
             long v1 = D_idx_of_vertex[v];
             long v2 = D_idx_of_vertex[v] + 1;
-            pair<long,long> u2v1 = make_pair(u2,v1);
-            pair<long,long> v2u1 = make_pair(v2,u1);
-
-            D_arcs[u2v1] = D.addArc(D_vertices[u2], D_vertices[v1]);
-            D_arcs[v2u1] = D.addArc(D_vertices[v2], D_vertices[u1]);
 
-            D_capacity[ D_arcs[u2v1] ] = UNLIMITED_CAPACITY;
-            D_capacity[ D_arcs[v2u1] ] = UNLIMITED_CAPACITY;
+            msi_add_arc(u2, v1, UNLIMITED_CAPACITY);
+            msi_add_arc(v2, u1, UNLIMITED_CAPACITY);
         }
     }
 
+    if (msi_csr_network)
+        msi_csr_network->build(D_size);
+
     /* 2. TRY EACH PAIR OF NON-ADJACENT VERTICES IN THE ORIGINAL GRAPH WHOSE
      * COMBINED Y VALUES IN THIS RELAXATION SOLUTION EXCEED 1 (THE CORRESPONDING 
      * MSI CANNOT BE VIOLATED OTHERWISE)
      */
 
-    bool done = false;
-    long num_trials = 0;
-    while (num_trials < num_vertices && !done)
+    // "cycling" through the initial source vertex tried (only relevant with
+    // MSI_STRATEGY_FIRST_CUT_BELOW_ROOT): sources are taken in turn by a pool
+    // of threads, each with its own max flow workspace over the same network
+    this->msi_first_source = this->msi_next_source;
+    this->msi_next_trial = 0;
+    this->msi_first_cut_order = numeric_limits<long>::max();
+    this->msi_first_cut_only = (MSI_STRATEGY_FIRST_CUT_BELOW_ROOT && !at_root_relaxation);
+
+    for (vector<MSIPairCut> &thread_cuts : msi_found)
+        thread_cuts.clear();
+
+    // wake up the pool, and take part in the round from the calling thread
+    {
+        std::lock_guard<std::mutex> lock(msi_pool_mutex);
+        msi_round_D_idx = &D_idx_of_vertex;
+        msi_workers_done = 0;
+        ++msi_round;
+    }
+    msi_round_started.notify_all();
+
+    msi_flow_worker(0, &D_idx_of_vertex, &msi_found[0]);
+
     {
-        // "cycling" through the initial source vertex tried (only relevant with MSI_STRATEGY_FIRST_CUT_BELOW_ROOT)
-        long s = this->msi_next_source;
-        long t = s+1;
-        while (t < num_vertices && !done)
+        std::unique_lock<std::mutex> lock(msi_pool_mutex);
+        msi_round_finished.wait(lock, [this]()
+            { return msi_workers_done == (long) msi_workers.size(); });
+        msi_round_D_idx = NULL;
+    }
+
+    // merge the cuts found in the order of a sequential search
+    vector<MSIPairCut> pair_cuts;
+    for (vector<MSIPairCut> &thread_cuts : msi_found)
+        for (MSIPairCut &cut : thread_cuts)
+            pair_cuts.push_back(cut);
+
+    sort(pair_cuts.begin(), pair_cuts.end(),
+         [](const MSIPairCut &a, const MSIPairCut &b) { return a.order < b.order; });
+
+    // all cuts found count as found, but only the first one might be added
+    this->msi_found_in_round = pair_cuts.size();
+
+    if (msi_first_cut_only && pair_cuts.size() > 1)
+        pair_cuts.resize(1);
+
+    for (MSIPairCut &cut : pair_cuts)
+    {
+        const long s = cut.s;
+        const long t = cut.t;
+        vector<long> &S = cut.separator;
+
+        // 7. DETERMINE INEQUALITY
+
+        GRBLinExpr violated_constr = 0;
+
+        violated_constr += y_vars[s];
+        violated_constr += y_vars[t];
+
+        for (vector<long>::iterator it = S.begin();
+                                    it != S.end(); ++it)
         {
-            // wanted: a (s_2, t_1) separating cut
-            long s_in_D = (y_val[s] > MSI_ZERO && y_val[s] < MSI_ONE) ? D_idx_of_vertex[s]+1
-                                                                      : D_idx_of_vertex[s];
+            violated_constr += ( (-1) * y_vars[*it] );
+        }
 
-            long t_in_D = D_idx_of_vertex[t];
+        cuts_lhs.push_back(violated_constr);
+        cuts_rhs.push_back(1);
+
+        #ifdef DEBUG_MSI
+            double violating_lhs = 0;
+
+            cout << "### ADDED MSI: ";
+            cout << "y_" << s << " + y_" << t;
 
-            if ( instance->graph->index_matrix[s][t] < 0 &&  // non-adjacent
-                 y_val[s] + y_val[t] > 1+MSI_EPSILON &&      // might cut y*
-                 s_in_D != t_in_D )                          // not contracted
+            violating_lhs += y_val[s];
+            violating_lhs += y_val[t];
+
+            for (vector<long>::iterator it = S.begin();
+                                        it != S.end(); ++it)
             {
-                // 3. MAX FLOW COMPUTATION
+                cout << " - y_" << *it << "";
+                violating_lhs -= y_val[*it];
+            }
 
-                /***
-                 * Using the first phase of Goldberg & Tarjan preflow
-                 * push-relabel algorithm (with "highest label" and "bound
-                 * decrease" heuristics). The worst case time complexity of
-                 * the algorithm is in O(n^2 * m^0.5), n and m wrt D
-                 */
+            cout << " <= 1 " << endl;
+            cout << right;
+            cout << setw(80) << "(lhs at current point "
+                 << violating_lhs << ")" << endl;
+            cout << left;
+        #endif
+    }
 
-                Preflow<SmartDigraph, SmartDigraph::ArcMap<double> >
-                    s_t_preflow(D, D_capacity, D_vertices[s_in_D],
-                                               D_vertices[t_in_D]);
+    // next call starts after the last source tried (the same one, after a
+    // full cycle)
+    if (msi_first_cut_only && !pair_cuts.empty())
+    {
+        long trials = pair_cuts.front().order / num_vertices + 1;
+        this->msi_next_source = (msi_first_source + trials) % num_vertices;
+    }
 
-                s_t_preflow.runMinCut();
-                
-                double mincut = s_t_preflow.flowValue();
+    return (cuts_lhs.size() > 0);
+}
 
-                // 4. IF THE MIN CUT IS LESS THAN WHAT THE MSI PRESCRIBES
-                // (UP TO A VIOLATION TOLERANCE), WE FOUND A CUT
+void WCMCutGenerator::msi_flow_worker(long thread_id,
+                                      const vector<long> *D_idx_of_vertex,
+                                      vector<MSIPairCut> *found)
+{
+    /***
+     * Try every pair (s,t) with t > s, for the sources s taken in turn, and
+     * keep the violated MSI found. If only the first cut is wanted, stop at
+     * pairs coming after one where a cut was already found (by any thread).
+     */
 
-                if (mincut < y_val[s] + y_val[t] - 1 - MSI_EPSILON)
+    while (true)
+    {
+        long trial = msi_next_trial++;
+        if (trial >= num_vertices)
+            return;
+
+        long s = (msi_first_source + trial) % num_vertices;
+
+        for (long t = s+1; t < num_vertices; ++t)
+        {
+            // position of this pair in a sequential search
+            long order = trial * num_vertices + t;
+            if (order > msi_first_cut_order)
+                return;
+
+            MSIPairCut cut;
+            if (msi_cut_for_pair(thread_id, *D_idx_of_vertex, s, t, cut.separator))
+            {
+                cut.order = order;
+                cut.s = s;
+                cut.t = t;
+                found->push_back(cut);
+
+                if (msi_first_cut_only)
                 {
-                    // 5. DETERMINE VERTICES IN ORIGINAL GRAPH CORRESPONDING
-                    // TO ARCS IN THE MIN CUT
+                    long current = msi_first_cut_order;
+                    while (order < current &&
+                           !msi_first_cut_order.compare_exchange_weak(current, order));
+
+                    return;
+                }
+            }
+        }
+    }
+}
 
-                    vector<long> S = vector<long>();
-                    vector<bool> S_mask = vector<bool>(num_vertices, false);
+void WCMCutGenerator::msi_pool_worker(long thread_id)
+{
+    /// thread of the pool: runs msi_flow_worker once in every round
 
-                    for (long u = 0; u < num_vertices; ++u)
-                    {
-                        if (u != s && u != t)
-                        {
-                            long u_in_D = D_idx_of_vertex[u];
+    long last_round = 0;
 
-                            // query if u1 is on the source side of the min cut
-                            if ( s_t_preflow.minCut(D_vertices[u_in_D]) )
-                            {
-                                bool u_at_zero = y_val[u] <= MSI_ZERO;
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(msi_pool_mutex);
+        msi_round_started.wait(lock, [this, last_round]()
+            { return msi_shutting_down || msi_round != last_round; });
 
-                                bool u_frac = y_val[u] > MSI_ZERO && y_val[u] < MSI_ONE;
+        if (msi_shutting_down)
+            return;
 
-                                long u2_in_D = u_frac ? D_idx_of_vertex[u]+1
-                                                      : D_idx_of_vertex[u];
+        last_round = msi_round;
+        const vector<long> *D_idx_of_vertex = msi_round_D_idx;
+        lock.unlock();
 
-                                bool u2_separated =
-                                   !s_t_preflow.minCut(D_vertices[u2_in_D]);
+        msi_flow_worker(thread_id, D_idx_of_vertex, &msi_found[thread_id]);
 
-                                if (u_at_zero || (u_frac && u2_separated) )
-                                {
-                                    S.push_back(u);
-                                    S_mask.at(u) = true;
-                                }
-                            }
-                        }
-                    }
+        lock.lock();
+        ++msi_workers_done;
+        lock.unlock();
+        msi_round_finished.notify_all();
+    }
+}
 
-                    // 6. LIFT CUT BY REDUCING S TO A MINIMAL SEPARATOR
-                    #ifdef DEBUG_MSI
-                        cout << "### (" << s << "," << t << ")- separator"
-                             << endl;
-                        cout << "### before lifting: { ";
+bool WCMCutGenerator::msi_cut_for_pair(long thread_id,
+                                       const vector<long> &D_idx_of_vertex,
+                                       long s,
+                                       long t,
+                                       vector<long> &S)
+{
+    /***
+     * Look for a minimal (s,t)-separator S giving a violated MSI, with a min
+     * cut in the auxiliary network. Returns true (with S filled) if found.
+     */
 
-                    for (vector<long>::iterator it = S.begin();
-                                                it != S.end(); ++it)
-                        cout << *it << " ";
+    // wanted: a (s_2, t_1) separating cut
+    long s_in_D = (y_val[s] > MSI_ZERO && y_val[s] < MSI_ONE) ? D_idx_of_vertex[s]+1
+                                                              : D_idx_of_vertex[s];
 
-                    cout << "}" << endl;
-                    #endif
+    long t_in_D = D_idx_of_vertex[t];
 
-                    lift_to_minimal_separator(S, S_mask, s, t);
+    if ( instance->graph->edge_index(s, t) >= 0 ||   // adjacent
+         y_val[s] + y_val[t] <= 1+MSI_EPSILON ||     // cannot cut y*
+         s_in_D == t_in_D )                          // contracted
+        return false;
 
-                    #ifdef DEBUG_MSI
-                        cout << "### after lifting: { ";
+    // 3. MAX FLOW COMPUTATION
 
-                    for (vector<long>::iterator it = S.begin();
-                                                it != S.end(); ++it)
-                        cout << *it << " ";
+    /***
+     * Using the first phase of Goldberg & Tarjan preflow
+     * push-relabel algorithm (with "highest label" and "bound
+     * decrease" heuristics in LEMON; FIFO, global relabeling and
+     * gap heuristics in WCMMaxFlow). The worst case time complexity
+     * of the algorithm is in O(n^2 * m^0.5), n and m wrt D
+     */
 
-                    cout << "}" << endl;
-                    #endif
+    // no MSI is violated once the flow reaches this value
+    const double cutoff = y_val[s] + y_val[t] - 1 - MSI_EPSILON;
 
-                    // 7. DETERMINE INEQUALITY
+    WCMMaxFlow *csr_flow = msi_csr_network ? msi_csr_flows[thread_id] : NULL;
+    MSIMaxFlow *lemon_flow = msi_network ? msi_preflows[thread_id] : NULL;
+    bool csr_violated = false;
+    bool lemon_violated = false;
 
-                    GRBLinExpr violated_constr = 0;
+    if (csr_flow)
+    {
+        const double start = wall_clock();
+        double mincut = csr_flow->run(s_in_D, t_in_D, cutoff);
+        csr_violated = (mincut < cutoff);
+
+        MaxFlowBenchmark &benchmark = msi_flow_benchmark[thread_id];
+        benchmark.csr_time += wall_clock() - start;
+        benchmark.csr_violated += csr_violated;
+        benchmark.csr_early_exits += csr_flow->reached_cutoff();
+    }
 
-                    violated_constr += y_vars[s];
-                    violated_constr += y_vars[t];
+    if (lemon_flow)
+    {
+        // the same workspace is re-targeted for every pair (and the flow is
+        // reset by runMinCut)
+        const double start = wall_clock();
+        lemon_flow->source(msi_network_nodes[s_in_D]);
+        lemon_flow->target(msi_network_nodes[t_in_D]);
+        lemon_flow->runMinCut();
+        lemon_violated = (lemon_flow->flowValue() < cutoff);
+
+        MaxFlowBenchmark &benchmark = msi_flow_benchmark[thread_id];
+        benchmark.lemon_time += wall_clock() - start;
+        benchmark.lemon_violated += lemon_violated;
+    }
 
-                    for (vector<long>::iterator it = S.begin();
-                                                it != S.end(); ++it)
-                    {
-                        violated_constr += ( (-1) * y_vars[*it] );
-                    }
+    if (csr_flow && lemon_flow)
+    {
+        msi_flow_benchmark[thread_id].pairs++;
+        if (csr_violated != lemon_violated)
+            msi_flow_benchmark[thread_id].disagreements++;
+    }
 
-                    cuts_lhs.push_back(violated_constr);
-                    cuts_rhs.push_back(1);
+    // 4. IF THE MIN CUT IS LESS THAN WHAT THE MSI PRESCRIBES
+    // (UP TO A VIOLATION TOLERANCE), WE FOUND A CUT
+
+    if (MSI_CSR_MAX_FLOW ? !csr_violated : !lemon_violated)
+        return false;
 
-                    #ifdef DEBUG_MSI
-                        double violating_lhs = 0;
+    // 5. DETERMINE VERTICES IN ORIGINAL GRAPH CORRESPONDING
+    // TO ARCS IN THE MIN CUT
 
-                        cout << "### ADDED MSI: ";
-                        cout << "y_" << s << " + y_" << t;
+    S.clear();
+    vector<bool> S_mask = vector<bool>(num_vertices, false);
 
-                        violating_lhs += y_val[s];
-                        violating_lhs += y_val[t];
+    for (long u = 0; u < num_vertices; ++u)
+    {
+        if (u != s && u != t)
+        {
+            long u_in_D = D_idx_of_vertex[u];
 
-                        for (vector<long>::iterator it = S.begin();
-                                                    it != S.end(); ++it)
-                        {
-                            cout << " - y_" << *it << "";
-                            violating_lhs -= y_val[*it];
-                        }
+            // query if u1 is on the source side of the min cut
+            bool u1_on_source_side = MSI_CSR_MAX_FLOW ?
+                csr_flow->source_side(u_in_D) :
+                lemon_flow->minCut(msi_network_nodes[u_in_D]);
 
-                        cout << " <= 1 " << endl;
-                        cout << right;
-                        cout << setw(80) << "(lhs at current point "
-                             << violating_lhs << ")" << endl;
-                        cout << left;
-                    #endif
+            if (u1_on_source_side)
+            {
+                bool u_at_zero = y_val[u] <= MSI_ZERO;
+
+                bool u_frac = y_val[u] > MSI_ZERO && y_val[u] < MSI_ONE;
+
+                long u2_in_D = u_frac ? D_idx_of_vertex[u]+1
+                                      : D_idx_of_vertex[u];
+
+                bool u2_separated = MSI_CSR_MAX_FLOW ?
+                   !csr_flow->source_side(u2_in_D) :
+                   !lemon_flow->minCut(msi_network_nodes[u2_in_D]);
 
-                    if (MSI_STRATEGY_FIRST_CUT_BELOW_ROOT && !at_root_relaxation)
-                        done = true;
+                if (u_at_zero || (u_frac && u2_separated) )
+                {
+                    S.push_back(u);
+                    S_mask.at(u) = true;
                 }
             }
-
-            ++t;
         }
+    }
+
+    // 6. LIFT CUT BY REDUCING S TO A MINIMAL SEPARATOR
+    #ifdef DEBUG_MSI
+        cout << "### (" << s << "," << t << ")- separator"
+             << endl;
+        cout << "### before lifting: { ";
+
+    for (vector<long>::iterator it = S.begin();
+                                it != S.end(); ++it)
+        cout << *it << " ";
+
+    cout << "}" << endl;
+    #endif
+
+    lift_to_minimal_separator(S, S_mask, s, t);
+
+    #ifdef DEBUG_MSI
+        cout << "### after lifting: { ";
+
+    for (vector<long>::iterator it = S.begin();
+                                it != S.end(); ++it)
+        cout << *it << " ";
+
+    cout << "}" << endl;
+    #endif
 
-        this->msi_next_source = (this->msi_next_source+1) % num_vertices;
-        ++num_trials;
+    return true;
+}
+
+MaxFlowBenchmark WCMCutGenerator::get_max_flow_benchmark()
+{
+    /// max flow comparison, summed over all threads of MSI separation
+
+    MaxFlowBenchmark total;
+
+    for (MaxFlowBenchmark &benchmark : msi_flow_benchmark)
+    {
+        total.pairs += benchmark.pairs;
+        total.lemon_violated += benchmark.lemon_violated;
+        total.csr_violated += benchmark.csr_violated;
+        total.csr_early_exits += benchmark.csr_early_exits;
+        total.lemon_time += benchmark.lemon_time;
+        total.csr_time += benchmark.csr_time;
+        total.disagreements += benchmark.disagreements;
     }
 
-    return (cuts_lhs.size() > 0);
+    return total;
+}
+
+void inline WCMCutGenerator::msi_add_arc(long tail, long head, double capacity)
+{
+    /// arc between nodes of the MSI auxiliary network, given by their index
+
+    if (msi_network)
+    {
+        SmartDigraph::Arc arc = msi_network->addArc(msi_network_nodes[tail],
+                                                    msi_network_nodes[head]);
+        (*msi_network_capacity)[arc] = capacity;
+    }
+
+    if (msi_csr_network)
+        msi_csr_network->add_arc(tail, head, capacity);
 }
 
 void inline WCMCutGenerator::lift_to_minimal_separator(vector<long> &S,
@@ -1362,52 +1976,41 @@ void inline WCMCutGenerator::lift_to_minimal_separator(vector<long> &S,
                                                        long s,
                                                        long t)
 {
-    /// Remove vertices from S until it is a minimal (s,t)-separator
-
-    bool updated = true;
-    while (updated)
-    {
-        updated = false;
+    /***
+     * Reduce S to a minimal (s,t)-separator in O(n + m), with two dfs'.
+     *
+     * S is a minimal (s,t)-separator if and only if every element in S has
+     * a neighbour both in the connected component of G-S containing s, and
+     * in the one containing t. The neighbours in S of the component C_s of
+     * G-S containing s form a separator S1 (and C_s is also a component of
+     * G-S1). Then the neighbours in S1 of the component of G-S1 containing t
+     * form a separator whose elements all have neighbours in both components.
+     */
 
-        const long len = S.size();
+    vector<bool> seen;
 
+    for (long source : {s, t})
+    {
         long count = 0;
-        vector<bool> seen = vector<bool>(num_vertices, false);
+        seen.assign(num_vertices, false);
+        dfs_avoiding_set(S, S_mask, source, seen, count);
 
-        // only try dfs from t if dfs from s found all vertices of S 
-        dfs_avoiding_set(S, S_mask, s, seen, count);
-        if (count == len)
+        // keep only the vertices of S found in the dfs
+        if (count < (long) S.size())
         {
-            count = 0;
-            seen.assign(num_vertices, false);
-            dfs_avoiding_set(S, S_mask, t, seen, count);
-        }
-
-        /***
-         * S is a minimal (s,t)-separator if and only if every element in S has
-         * a neighbour both in the connected component of G-S containing s, and  
-         * in the one containing t. So we may remove from S a vertex not found
-         * in either dfs' above.
-         */
-        if (count < len)
-        {
-            long i = 0;
-            while (i < len && !updated)
+            long kept = 0;
+            for (unsigned long i = 0; i < S.size(); ++i)
             {
-                long vertex_at_i = S.at(i);
-
-                if ( !seen.at(vertex_at_i) )
-                {
-                    updated = true;
-                    S.erase(S.begin() + i);
+                long vertex_at_i = S[i];
+                if (seen.at(vertex_at_i))
+                    S[kept++] = vertex_at_i;
+                else
                     S_mask.at(vertex_at_i) = false;
-                }
-
-                ++i;
             }
-        }
 
-    }  // repeat search if S was updated 
+            S.resize(kept);
+        }
+    }
 }
 
 void inline WCMCutGenerator::dfs_avoiding_set(vector<long> &S,
@@ -1422,10 +2025,10 @@ void inline WCMCutGenerator::dfs_avoiding_set(vector<long> &S,
 
     seen.at(source) = true;
 
-    for (list<long>::iterator it = instance->graph->adj_list.at(source).begin();
-        it != instance->graph->adj_list.at(source).end(); ++it)
+    for (long k = instance->graph->adj_offset[source];
+         k < instance->graph->adj_offset[source+1]; ++k)
     {
-        long v = *it;
+        long v = instance->graph->adj_pairs[2*k];
 
         if ( !seen.at(v) )
         {
@@ -1440,3 +2043,147 @@ void inline WCMCutGenerator::dfs_avoiding_set(vector<long> &S,
         }
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+void inline WCMCutGenerator::set_heuristic_solution(const vector<bool> &solution)
+{
+    /// pass a connected matching (and the vertices it covers) to the solver
+
+    double *x_sol = new double[num_edges];
+    double *y_sol = new double[num_vertices];
+
+    for (long u = 0; u < num_vertices; ++u)
+        y_sol[u] = 0;
+
+    for (long idx = 0; idx < num_edges; ++idx)
+    {
+        x_sol[idx] = solution[idx] ? 1 : 0;
+
+        if (solution[idx])
+        {
+            y_sol[instance->graph->s[idx]] = 1;
+            y_sol[instance->graph->t[idx]] = 1;
+        }
+    }
+
+    setSolution(x_vars, x_sol, num_edges);
+    setSolution(y_vars, y_sol, num_vertices);
+
+    delete[] x_sol;
+    delete[] y_sol;
+}
+
+bool WCMCutGenerator::run_lp_rounding()
+{
+    /***
+     * Round the node relaxation into a connected matching, and submit it to
+     * the solver if it improves the incumbent. NB! Gurobi does not report the
+     * depth of the node in callbacks, so calls are spaced by node count.
+     */
+
+    double node_count = getDoubleInfo(GRB_CB_MIPNODE_NODCNT);
+
+    if (at_root_relaxation)
+    {
+        if (rounding_root_failures >= LP_ROUNDING_ROOT_FAILURES)
+            return false;
+    }
+    else if (node_count < rounding_next_node)
+        return false;
+
+    ++rounding_calls;
+
+    vector<bool> solution;
+    double weight = primal_heuristic->lp_rounding(x_val, solution);
+
+    bool improved = (weight > getDoubleInfo(GRB_CB_MIPNODE_OBJBST) +
+                              LP_ROUNDING_EPSILON);
+
+    if (improved)
+    {
+        set_heuristic_solution(solution);
+        useSolution();
+
+        ++rounding_improvements;
+        rounding_interval = LP_ROUNDING_MIN_INTERVAL;
+    }
+    else
+    {
+        if (at_root_relaxation)
+            ++rounding_root_failures;
+
+        rounding_interval = min(2 * rounding_interval, LP_ROUNDING_MAX_INTERVAL);
+    }
+
+    rounding_next_node = node_count + rounding_interval;
+
+    return improved;
+}
+
+bool WCMCutGenerator::run_solution_repair()
+{
+    /***
+     * The integer solution in a MIPSOL callback was cut off by some MSI, i.e.
+     * its covered vertices are disconnected: keep its heaviest connected part
+     * (rounding the integer point merges other parts through connector edges,
+     * whenever that pays off), improve it by local search, and post it as a
+     * heuristic solution if it beats the incumbent.
+     */
+
+    ++repair_calls;
+
+    x_val = this->getSolution(x_vars, num_edges);
+
+    vector<bool> solution;
+    primal_heuristic->lp_rounding(x_val, solution);
+    double weight = primal_heuristic->local_search(solution);
+
+    delete[] x_val;
+
+    if (weight <= getDoubleInfo(GRB_CB_MIPSOL_OBJBST) + LP_ROUNDING_EPSILON)
+        return false;
+
+    // NB! in MIPSOL, gurobi queues the solution to be checked later on
+    set_heuristic_solution(solution);
+
+    ++repair_improvements;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool WCMCutGenerator::post_lns_improvement()
+{
+    /// pass the solver a solution found by the lns, if it beats the incumbent
+
+    vector<bool> solution;
+    double weight;
+
+    if (!lns->take_improvement(solution, weight))
+        return false;
+
+    if (weight <= getDoubleInfo(GRB_CB_MIPNODE_OBJBST) + LP_ROUNDING_EPSILON)
+        return false;
+
+    set_heuristic_solution(solution);
+    useSolution();
+
+    ++lns_solutions_used;
+    return true;
+}
+
+void WCMCutGenerator::offer_lns_incumbent()
+{
+    /// a new (connected) incumbent in MIPSOL becomes the center of the lns
+
+    x_val = this->getSolution(x_vars, num_edges);
+
+    vector<bool> solution = vector<bool>(num_edges, false);
+    for (long idx = 0; idx < num_edges; ++idx)
+        solution[idx] = (x_val[idx] > 0.5);
+
+    delete[] x_val;
+
+    lns->offer_incumbent(solution, getDoubleInfo(GRB_CB_MIPSOL_OBJ));
+}
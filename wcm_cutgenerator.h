@@ -5,6 +5,13 @@
 #include <sstream>
 #include <iomanip>
 #include <map>
+#include <ctime>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include "gurobi_c++.h"
 
@@ -14,23 +21,78 @@
 #include <lemon/preflow.h>
 
 // using the Gomory-Hu cut tree in COIN-OR:LEMON (see: www.lemon.cs.elte.hu)
-#include <lemon/list_graph.h>
 #include <lemon/gomory_hu.h>
 using namespace lemon;
 
 #include "io.h"
 #include "wcm_model.h"
+#include "wcm_heuristic.h"
+#include "wcm_cuttree.h"
+#include "wcm_maxflow.h"
+
+class WCMLNS;
 
 // kinds of cuts
 #define ADD_USER_CUTS 1
 #define ADD_LAZY_CNTRS 2
 #define ADD_STD_CNTRS 3
 
+// separation statistics for each family of inequalities
+struct SeparationStats
+{
+    long rounds = 0;              // calls to the separation procedure
+    long found = 0;               // violated inequalities found (added or not)
+    long added_as_user_cuts = 0;  // ADD_USER_CUTS
+    long added_as_lazy = 0;       // ADD_LAZY_CNTRS
+    long added_to_lp = 0;         // ADD_STD_CNTRS (dedicated LP relaxation)
+    double wall_time = 0;
+    double cpu_time = 0;          // of the separating thread only
+};
+
+// comparison of the two exact blossom separators on the same lp points
+struct BlossomBenchmark
+{
+    long points = 0;              // lp points given to both separators
+    long padberg_rao_found = 0;   // violated BI found by each of them
+    long fractional_found = 0;
+    double padberg_rao_time = 0;  // wall time of each of them
+    double fractional_time = 0;
+    long disagreements = 0;       // points where only one found a violated BI
+};
+
+typedef GomoryHu<SmartGraph, SmartGraph::EdgeMap<double> > BICutTree;
+typedef Preflow<SmartDigraph, SmartDigraph::ArcMap<double> > MSIMaxFlow;
+
+// comparison of the two max flow implementations on the same (s,t) pairs of
+// MSI separation (only pairs given to both are counted)
+struct MaxFlowBenchmark
+{
+    long pairs = 0;               // pairs given to both implementations
+    long lemon_violated = 0;      // pairs giving a violated MSI with each
+    long csr_violated = 0;
+    long csr_early_exits = 0;     // flow reached y_s + y_t - 1 (no violation)
+    double lemon_time = 0;        // wall time of each of them (summed over threads)
+    double csr_time = 0;
+    long disagreements = 0;       // pairs where only one found a violated MSI
+};
+
+// minimal (s,t)-separator giving a violated MSI, found by one of the threads
+struct MSIPairCut
+{
+    long order;                   // of the pair (s,t) in a sequential search
+    long s;
+    long t;
+    vector<long> separator;
+};
+
 /***
  * \file wcm_cutgenerator.h
  * 
  * Module for the Gurobi callback class, implementing the separation procedure
- * for blossom, minimal separators and indegree inequalities
+ * for blossom, minimal separators and indegree inequalities, and running
+ * primal heuristics: lp rounding at MIP nodes, and repair (followed by local
+ * search) of integer solutions cut off by lazy constraints. Incumbents are
+ * also exchanged with a large neighbourhood search, if one is running.
  * 
  * Extends (and implements) the abstract base class in Gurobi.
  * 
@@ -50,12 +112,16 @@ protected:
     void callback();
     bool separate_lpr();
 
+    void inline record_separation_round(SeparationStats &, long, long, int,
+                                        double, double);
+
     // input and model data
     IO *instance;
     GRBModel *model;
     long num_vertices;
     long num_edges;
     bool at_root_relaxation;
+    long solver_threads;    // threads parameter of the model (cap of our own)
 
     GRBVar *x_vars, *y_vars;
     double *x_val, *y_val;
@@ -63,8 +129,12 @@ protected:
     void inline clean_vars_beyond_precision(int);
 
     long blossom_counter;
+    SeparationStats blossom_stats;
     bool run_blossom_separation(int);
     bool separate_blossom_exactly(vector<GRBLinExpr> &, vector<long> &);
+    bool separate_blossom_on_fractional_support(vector<GRBLinExpr> &, vector<long> &);
+    bool benchmark_blossom_exactly(vector<GRBLinExpr> &, vector<long> &);
+    BlossomBenchmark blossom_benchmark;
     bool separate_blossom_heuristically(vector<GRBLinExpr> &, vector<long> &);
     double inline bi_lhs_from_handle(vector<long> &, vector<bool> &, GRBLinExpr &);
     void inline get_fractional_info(vector<bool> &, vector<bool> &);
@@ -73,20 +143,87 @@ protected:
                                  long,
                                  vector<long> &,
                                  vector<bool> &);
-    ListGraph *bi_support_graph;
-    vector<ListGraph::Node> bi_support_vertices;
-    vector<ListGraph::Edge> bi_support_edges;
-    ListGraph::EdgeMap<double> *bi_support_capacity;
+    SmartGraph *bi_support_graph;
+    vector<SmartGraph::Node> bi_support_vertices;
+    vector<SmartGraph::Edge> bi_support_edges;
+    SmartGraph::EdgeMap<double> *bi_support_capacity;
+
+    // workspace of exact BI separation, kept for the lifetime of the generator
+    BICutTree *bi_cut_tree;
+    WCMCutTree *bi_parallel_cut_tree;
+    vector<long> bi_support_node_vertex;  // node id -> vertex (-1 for dummy)
+    vector<long> bi_handle_vertices;
+    vector<bool> bi_handle_mask;
+    template <class CutTree>
+    void bi_cuts_from_cut_tree(SmartGraph &,
+                               CutTree &,
+                               vector<long> &,
+                               vector<GRBLinExpr> &,
+                               vector<long> &);
+
+    // workspace of exact BI separation on the fractional support only: the
+    // topology of the graph is rebuilt at each call, while the capacity map
+    // and the cut tree (bound to it) are kept
+    SmartGraph *bi_frac_graph;
+    SmartGraph::EdgeMap<double> *bi_frac_capacity;
+    BICutTree *bi_frac_cut_tree;
+    WCMCutTree *bi_frac_parallel_cut_tree;
+    vector<long> bi_frac_vertices;  // node id in bi_frac_graph -> vertex
+    vector<long> bi_frac_node;      // vertex -> node id (-1 if not fractional)
 
     long indegree_counter;
+    SeparationStats indegree_stats;
     bool run_indegree_separation(int);
     bool separate_indegree(vector<GRBLinExpr> &, vector<long> &);
 
     long minimal_separators_counter;
+    SeparationStats minimal_separators_stats;
     bool run_minimal_separators_separation(int);
     bool separate_minimal_separators_std(vector<GRBLinExpr> &, vector<long> &);
     bool separate_minimal_separators_integral(vector<GRBLinExpr> &, vector<long> &);
+    MaxFlowBenchmark get_max_flow_benchmark();
     long msi_next_source;
+    long msi_found_in_round;    // violated MSI found, even if not all added
+
+    // workspace of MSI separation at fractional points: auxiliary network D
+    // (nodes indexed 0, ..., 2n-1) as a LEMON digraph and/or in CSR format,
+    // and the max flow objects bound to it (one per thread)
+    SmartDigraph *msi_network;
+    vector<SmartDigraph::Node> msi_network_nodes;
+    SmartDigraph::ArcMap<double> *msi_network_capacity;
+    SmartDigraph::Snapshot *msi_network_snapshot;
+    vector<MSIMaxFlow*> msi_preflows;
+    WCMFlowNetwork *msi_csr_network;
+    vector<WCMMaxFlow*> msi_csr_flows;
+    vector<MaxFlowBenchmark> msi_flow_benchmark;  // by thread
+    void inline msi_add_arc(long, long, double);
+
+    // (s,t) pairs are tried by a pool of threads, with their own workspaces
+    long msi_num_threads;
+    long msi_first_source;
+    std::atomic<long> msi_next_trial;
+    std::atomic<long> msi_first_cut_order;  // cancels pairs after a first cut
+    bool msi_first_cut_only;
+    void msi_flow_worker(long, const vector<long> *, vector<MSIPairCut> *);
+    bool msi_cut_for_pair(long,
+                          const vector<long> &,
+                          long,
+                          long,
+                          vector<long> &);
+
+    // the threads of the pool (but the calling one) live as long as the
+    // generator, and wait between rounds of separation
+    vector<std::thread> msi_workers;
+    std::mutex msi_pool_mutex;
+    std::condition_variable msi_round_started;
+    std::condition_variable msi_round_finished;
+    long msi_round;
+    long msi_workers_done;
+    bool msi_shutting_down;
+    const vector<long> *msi_round_D_idx;      // of the current round
+    vector< vector<MSIPairCut> > msi_found;   // by thread
+    void msi_pool_worker(long);
+
     void inline lift_to_minimal_separator(vector<long> &,
                                           vector<bool> &,
                                           long,
@@ -96,6 +233,26 @@ protected:
                                  long,
                                  vector<bool> &,
                                  long &);
+
+    // primal heuristics: lp rounding, throttled by its success, and repair
+    WCMHeuristic *primal_heuristic;
+    long rounding_calls;
+    long rounding_improvements;
+    long rounding_root_failures;
+    double rounding_interval;       // in number of nodes, below the root
+    double rounding_next_node;
+    bool run_lp_rounding();
+
+    long repair_calls;
+    long repair_improvements;
+    bool run_solution_repair();
+    void inline set_heuristic_solution(const vector<bool> &);
+
+    WCMLNS *lns;
+    long lns_solutions_used;
+    const std::atomic<bool> *stop_flag;   // abort the solver once it is set
+    bool post_lns_improvement();
+    void offer_lns_incumbent();
 };
 
 #endif
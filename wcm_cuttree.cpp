@@ -0,0 +1,391 @@
+#include "wcm_cuttree.h"
+
+// below this many nodes, the cut tree is built in the calling thread only
+const long CUT_TREE_MIN_NODES_PER_THREAD = 32;
+
+// speculative flows computed ahead of the next one to be applied, per thread
+const long CUT_TREE_WINDOW_PER_THREAD = 2;
+
+WCMCutTree::WCMCutTree(const SmartGraph &graph,
+                       const Capacity &capacity,
+                       long num_threads)
+    : graph(graph), capacity(capacity)
+{
+    /***
+     * num_threads counts the calling thread (0 for one per hardware thread).
+     * The other threads are started here, and wait for the runs to come.
+     */
+
+    if (num_threads < 1)
+        num_threads = std::thread::hardware_concurrency();
+    if (num_threads < 1)
+        num_threads = 1;
+
+    this->num_threads = num_threads;
+    this->num_flows = 0;
+    this->num_recomputed_flows = 0;
+    this->num_nodes = 0;
+    this->next_node = 0;
+    this->next_commit = 0;
+    this->window = 0;
+
+    this->workspace_nodes = 0;
+    this->num_workers = 0;
+    this->run_counter = 0;
+    this->workers_done = 0;
+    this->shutting_down = false;
+
+    // the graph may still be empty (e.g. rebuilt at each separation call)
+    if (graph.maxNodeId() + 1 >= 2)
+        allocate_workspaces();
+
+    for (long i = 1; i < num_threads; ++i)
+        workers.push_back(std::thread(&WCMCutTree::worker, this, i));
+}
+
+WCMCutTree::~WCMCutTree()
+{
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        shutting_down = true;
+    }
+    run_started.notify_all();
+
+    for (std::thread &t : workers)
+        t.join();
+
+    for (MaxFlow *flow : workspaces)
+        delete flow;
+
+    results.clear();
+}
+
+void WCMCutTree::allocate_workspaces()
+{
+    /***
+     * One flow workspace per thread, for the current number of nodes (at
+     * least 2). They are allocated in the calling thread, as LEMON maps
+     * register themselves with the graph: worker threads only read the graph.
+     */
+
+    for (MaxFlow *flow : workspaces)
+        delete flow;
+    workspaces.clear();
+
+    for (long i = 0; i < num_threads; ++i)
+    {
+        MaxFlow *flow = new MaxFlow(graph, capacity,
+                                    graph.nodeFromId(1), graph.nodeFromId(0));
+        flow->init();
+        workspaces.push_back(flow);
+    }
+
+    this->workspace_nodes = graph.maxNodeId() + 1;
+}
+
+void WCMCutTree::run()
+{
+    /***
+     * Gusfield's algorithm: for each node n but the root, in order of node id,
+     * compute a min cut between n and its current predecessor t, and update
+     * the tree accordingly. Flows are computed by up to num_threads-1 workers
+     * (and by the calling thread, when it would otherwise wait), and applied
+     * by the calling thread.
+     */
+
+    // nodes of a SmartGraph are numbered consecutively (ids 0, 1, ..., N-1)
+    this->num_nodes = graph.maxNodeId() + 1;
+
+    pred.assign(num_nodes, 0);
+    weight.assign(num_nodes, 0);
+    if (num_nodes > 0)
+        pred[0] = -1;
+
+    num_flows = 0;
+    num_recomputed_flows = 0;
+
+    if (num_nodes < 2)
+    {
+        build_preorder();
+        return;
+    }
+
+    if (workspace_nodes != num_nodes)
+        allocate_workspaces();
+
+    results.assign(num_nodes, FlowResult());
+
+    long active_workers = min(num_threads - 1,
+                              num_nodes / CUT_TREE_MIN_NODES_PER_THREAD);
+    if (active_workers < 0)
+        active_workers = 0;
+
+    // wake up the workers taking part in this run
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        num_workers = active_workers;
+        next_node = 1;
+        next_commit = 1;
+        window = CUT_TREE_WINDOW_PER_THREAD * (num_workers + 1);
+        workers_done = 0;
+        ++run_counter;
+    }
+    run_started.notify_all();
+
+    for (long n = 1; n < num_nodes; ++n)
+    {
+        std::unique_lock<std::mutex> lock(tree_mutex);
+
+        // the calling thread computes the flow of n itself if no worker has
+        // taken it yet, and waits for it otherwise
+        if (next_node == n)
+        {
+            ++next_node;
+            long target = pred[n];
+            lock.unlock();
+            min_cut(*workspaces[0], n, target, results[n]);
+            lock.lock();
+        }
+        else
+            result_ready.wait(lock, [&]{ return results[n].ready; });
+
+        // discard a speculative flow whose target is no longer the predecessor
+        if (results[n].target != pred[n])
+        {
+            ++num_recomputed_flows;
+            long target = pred[n];
+            lock.unlock();
+            min_cut(*workspaces[0], n, target, results[n]);
+            lock.lock();
+        }
+
+        commit(n);
+        ++next_commit;
+        lock.unlock();
+        window_moved.notify_all();
+    }
+
+    // the workers must be done with this run before the next one starts
+    {
+        std::unique_lock<std::mutex> lock(tree_mutex);
+        run_finished.wait(lock, [&]{ return workers_done == num_workers; });
+    }
+
+    results.clear();
+    build_preorder();
+}
+
+void WCMCutTree::worker(long id)
+{
+    /// compute flows ahead of the tree updates, with the predecessors known now
+
+    FlowResult result;
+    long last_run = 0;
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(tree_mutex);
+        run_started.wait(lock, [&]{ return shutting_down ||
+                                           run_counter != last_run; });
+
+        if (shutting_down)
+            return;
+
+        last_run = run_counter;
+
+        // not needed in this run (too few nodes)
+        if (id > num_workers)
+            continue;
+
+        MaxFlow *flow = workspaces[id];
+
+        while (true)
+        {
+            window_moved.wait(lock, [&]{ return next_node >= num_nodes ||
+                                                next_node < next_commit + window; });
+
+            if (next_node >= num_nodes)
+                break;
+
+            long n = next_node++;
+            long target = pred[n];
+            lock.unlock();
+
+            min_cut(*flow, n, target, result);
+
+            lock.lock();
+            std::swap(results[n], result);
+            results[n].ready = true;
+            result_ready.notify_all();
+        }
+
+        ++workers_done;
+        lock.unlock();
+        run_finished.notify_all();
+    }
+}
+
+void WCMCutTree::min_cut(MaxFlow &flow, long s, long t, FlowResult &result)
+{
+    /// min cut between nodes s and t, keeping the side of s
+
+    flow.source(graph.nodeFromId(s));
+    flow.target(graph.nodeFromId(t));
+    flow.runMinCut();
+
+    result.target = t;
+    result.value = flow.flowValue();
+    result.source_side.assign(num_nodes, false);
+    for (long i = 0; i < num_nodes; ++i)
+        result.source_side[i] = flow.minCut(graph.nodeFromId(i));
+
+    result.ready = true;
+}
+
+void WCMCutTree::commit(long n)
+{
+    /// apply the min cut between n and its predecessor (as in lemon::GomoryHu)
+
+    ++num_flows;
+
+    const FlowResult &result = results[n];
+    const long t = result.target;
+
+    weight[n] = result.value;
+
+    for (long i = 0; i < num_nodes; ++i)
+        if (i != n && result.source_side[i] && pred[i] == t)
+            pred[i] = n;
+
+    if (pred[t] >= 0 && result.source_side[pred[t]])
+    {
+        pred[n] = pred[t];
+        pred[t] = n;
+        weight[n] = weight[t];
+        weight[t] = result.value;
+    }
+
+    results[n].source_side = vector<bool>();
+}
+
+void WCMCutTree::build_preorder()
+{
+    /// dfs over the cut tree from the root, recording subtree ranges
+
+    vector<long> children_offset(num_nodes + 1, 0);
+    vector<long> children(num_nodes > 0 ? num_nodes - 1 : 0);
+
+    for (long i = 0; i < num_nodes; ++i)
+        if (pred[i] >= 0)
+            ++children_offset[pred[i] + 1];
+
+    for (long i = 0; i < num_nodes; ++i)
+        children_offset[i+1] += children_offset[i];
+
+    vector<long> fill = vector<long>(children_offset.begin(),
+                                     children_offset.end() - 1);
+    for (long i = 0; i < num_nodes; ++i)
+        if (pred[i] >= 0)
+            children[fill[pred[i]]++] = i;
+
+    preorder.clear();
+    preorder.reserve(num_nodes);
+    position.assign(num_nodes, 0);
+    subtree_end.assign(num_nodes, 0);
+
+    if (num_nodes == 0)
+        return;
+
+    // iterative dfs: a node is pushed once on entry, and again (negated, -1
+    // for node 0) to close its subtree range on exit
+    vector<long> stack;
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        long u = stack.back();
+        stack.pop_back();
+
+        if (u < 0)
+        {
+            subtree_end[-u - 1] = preorder.size();
+            continue;
+        }
+
+        position[u] = preorder.size();
+        preorder.push_back(u);
+        stack.push_back(-u - 1);
+
+        for (long k = children_offset[u]; k < children_offset[u+1]; ++k)
+            stack.push_back(children[k]);
+    }
+}
+
+WCMCutTree::Node WCMCutTree::predNode(const Node &node) const
+{
+    long p = pred[graph.id(node)];
+    return (p >= 0) ? graph.nodeFromId(p) : Node(INVALID);
+}
+
+double WCMCutTree::predValue(const Node &node) const
+{
+    return weight[graph.id(node)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+WCMCutTree::MinCutNodeIt::MinCutNodeIt(const WCMCutTree &tree,
+                                       const Node &s,
+                                       const Node &t,
+                                       bool s_side)
+{
+    /// NB! s and t must be adjacent in the cut tree
+
+    this->tree = &tree;
+
+    long s_id = tree.graph.id(s);
+    long t_id = tree.graph.id(t);
+
+    // removing the tree edge leaves the subtree of the child on one side
+    long child = (tree.pred[s_id] == t_id) ? s_id : t_id;
+    bool child_side = (child == s_id) ? s_side : !s_side;
+
+    long first = tree.position[child];
+    long last = tree.subtree_end[child];
+
+    if (child_side)
+    {
+        this->index = first;
+        this->end = last;
+        this->skip_begin = this->skip_end = last;
+    }
+    else
+    {
+        this->index = (first == 0) ? last : 0;
+        this->end = tree.num_nodes;
+        this->skip_begin = first;
+        this->skip_end = last;
+    }
+}
+
+WCMCutTree::MinCutNodeIt::operator Node() const
+{
+    return tree->graph.nodeFromId(tree->preorder[index]);
+}
+
+WCMCutTree::MinCutNodeIt& WCMCutTree::MinCutNodeIt::operator++()
+{
+    ++index;
+    if (index == skip_begin)
+        index = skip_end;
+    return *this;
+}
+
+bool WCMCutTree::MinCutNodeIt::operator==(Invalid) const
+{
+    return index >= end;
+}
+
+bool WCMCutTree::MinCutNodeIt::operator!=(Invalid) const
+{
+    return index < end;
+}
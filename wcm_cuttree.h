@@ -0,0 +1,131 @@
+#ifndef _WCM_CUT_TREE_H_
+#define _WCM_CUT_TREE_H_
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// using the preflow-push algorithm in COIN-OR:LEMON (see: www.lemon.cs.elte.hu)
+#include <lemon/smart_graph.h>
+#include <lemon/preflow.h>
+using namespace lemon;
+
+using namespace std;
+
+/***
+ * \file wcm_cuttree.h
+ *
+ * Module for a multi-threaded Gomory-Hu cut tree construction (Gusfield's
+ * variant, with the same tree updates as the GomoryHu class in LEMON) over a
+ * SmartGraph with edge capacities.
+ *
+ * The max flow computed for each node depends on the tree only through its
+ * current predecessor, so worker threads (each with its own Preflow workspace
+ * over the shared, read-only graph) compute the flows of the next few nodes
+ * speculatively. The calling thread applies their results in node order, and
+ * recomputes a flow only if the predecessor changed in the meantime: the tree
+ * obtained is the same as with a single thread.
+ *
+ * The worker threads and their workspaces live as long as the object, so the
+ * graph may be rebuilt and the tree run again at each call of a separation
+ * procedure. The workspaces are only reallocated when the number of nodes
+ * changes (the elevator of lemon::Preflow is sized at construction).
+ *
+ * Queries follow the interface of lemon::GomoryHu (predNode, predValue and
+ * MinCutNodeIt) for nodes adjacent in the cut tree.
+ *
+ * \author Phillippe Samer <samer@uib.no>
+ * \date 17.10.2026
+ */
+
+class WCMCutTree
+{
+public:
+    typedef SmartGraph::Node Node;
+    typedef SmartGraph::EdgeMap<double> Capacity;
+
+    WCMCutTree(const SmartGraph &, const Capacity &, long);
+    virtual ~WCMCutTree();
+
+    void run();
+
+    Node predNode(const Node &) const;
+    double predValue(const Node &) const;
+
+    long num_threads;
+    long num_flows;               // max flows computed in the last run
+    long num_recomputed_flows;    // of which discarded speculative results
+
+    // nodes on one side of the min cut given by the cut tree edge s-t
+    class MinCutNodeIt
+    {
+    public:
+        MinCutNodeIt(const WCMCutTree &, const Node &, const Node &, bool = true);
+
+        operator Node() const;
+        MinCutNodeIt& operator++();
+        bool operator==(Invalid) const;
+        bool operator!=(Invalid) const;
+
+    protected:
+        const WCMCutTree *tree;
+        long index;                 // current position in the preorder
+        long end;
+        long skip_begin, skip_end;  // range of the preorder not on this side
+    };
+
+protected:
+    typedef Preflow<SmartGraph, Capacity> MaxFlow;
+
+    const SmartGraph &graph;
+    const Capacity &capacity;
+    long num_nodes;
+
+    // cut tree (by node id, rooted at node 0) and its preorder, where the
+    // subtree of each node occupies positions [position, subtree_end)
+    vector<long> pred;
+    vector<double> weight;
+    vector<long> preorder;
+    vector<long> position;
+    vector<long> subtree_end;
+    void build_preorder();
+
+    // speculative flows, by node id
+    struct FlowResult
+    {
+        bool ready = false;
+        long target = -1;
+        double value = 0;
+        vector<bool> source_side;
+    };
+
+    vector<FlowResult> results;
+    std::mutex tree_mutex;
+    std::condition_variable window_moved;
+    std::condition_variable result_ready;
+    long next_node;       // next node whose flow is to be computed
+    long next_commit;     // next node whose flow is to be applied to the tree
+    long window;          // how far ahead of next_commit flows are computed
+
+    // persistent pool: workers 1, ..., num_workers take part in the current
+    // run, and the calling thread uses workspace 0
+    vector<std::thread> workers;
+    vector<MaxFlow*> workspaces;
+    long workspace_nodes;   // number of nodes the workspaces were built for
+    long num_workers;
+    long run_counter;
+    long workers_done;
+    bool shutting_down;
+    std::condition_variable run_started;
+    std::condition_variable run_finished;
+
+    void allocate_workspaces();
+    void worker(long);
+    void min_cut(MaxFlow &, long, long, FlowResult &);
+    void commit(long);
+};
+
+#endif
@@ -0,0 +1,453 @@
+#include "wcm_decomposition.h"
+
+// tolerance in comparing bounds and incumbent weights
+const double DECOMPOSITION_EPSILON = 1e-6;
+
+WCMDecomposition::WCMDecomposition(IO *instance, vector<GRBEnv*> *worker_envs)
+{
+    /***
+     * If worker_envs is given, workers use (and add to) those environments,
+     * which are NOT deleted with this object; otherwise, each solve() starts
+     * dedicated ones.
+     */
+
+    this->instance = instance;
+    this->worker_envs = worker_envs;
+
+    const long n = instance->graph->num_vertices;
+    const long m = instance->graph->num_edges;
+
+    this->num_pruned_components = 0;
+    this->num_solved_components = 0;
+    this->num_closed_by_matching = 0;
+
+    // empty matching is always feasible
+    this->solution_weight = 0;
+    this->solution_dualbound = numeric_limits<double>::max();
+    this->solution_vector_x = vector<bool>(m, false);
+    this->solution_status = STATUS_UNKNOWN;
+    this->solution_runtime = -1;
+
+    this->mip_num_nodes = 0;
+    this->blossom_counter = 0;
+    this->msi_counter = 0;
+    this->indegree_counter = 0;
+
+    // 1. A SINGLE EDGE OF MAXIMUM WEIGHT IS A FIRST INCUMBENT
+    long best_edge = -1;
+    for (long e = 0; e < m; ++e)
+        if (instance->graph->w[e] > solution_weight)
+        {
+            solution_weight = instance->graph->w[e];
+            best_edge = e;
+        }
+
+    if (best_edge >= 0)
+        solution_vector_x[best_edge] = true;
+
+    // 2. NONTRIVIAL CONNECTED COMPONENTS (WITH AT LEAST ONE EDGE)
+    vector<long> component;
+    long total_components = instance->graph->connected_components(component);
+
+    vector< vector<long> > vertices_by_component(total_components);
+    for (long u = 0; u < n; ++u)
+        vertices_by_component[component[u]].push_back(u);
+
+    this->local_index = vector<long>(n, -1);
+
+    vector< pair<double, long> > bound_and_component;
+    for (long c = 0; c < total_components; ++c)
+    {
+        if (vertices_by_component[c].size() < 2)
+            continue;
+
+        for (unsigned long i = 0; i < vertices_by_component[c].size(); ++i)
+            local_index[vertices_by_component[c][i]] = i;
+
+        bound_and_component.push_back(make_pair(
+            component_upper_bound(vertices_by_component[c]), c));
+    }
+
+    // 3. MOST PROMISING COMPONENTS FIRST
+    sort(bound_and_component.begin(), bound_and_component.end(),
+         [](const pair<double,long> &a, const pair<double,long> &b)
+         { return a.first > b.first; });
+
+    this->num_components = bound_and_component.size();
+    for (long idx = 0; idx < num_components; ++idx)
+    {
+        component_bound.push_back(bound_and_component[idx].first);
+        component_vertices.push_back(
+            vertices_by_component[bound_and_component[idx].second]);
+    }
+
+    this->component_dualbound = component_bound;
+
+    this->component_index = vector<long>(n, -1);
+    for (long idx = 0; idx < num_components; ++idx)
+        for (long u : component_vertices[idx])
+            component_index[u] = idx;
+}
+
+WCMDecomposition::~WCMDecomposition()
+{
+    component_vertices.clear();
+    component_bound.clear();
+    component_dualbound.clear();
+    local_index.clear();
+    component_index.clear();
+}
+
+double WCMDecomposition::component_upper_bound(const vector<long> &vertices)
+{
+    /***
+     * Upper bound on the weight of a connected matching in a component: the
+     * minimum between the sum of positive edge weights, and half the sum over
+     * vertices of the best positive weight of an incident edge (each matching
+     * edge uv is counted once at u and once at v).
+     */
+
+    double positive_sum = 0;
+    double half_vertex_sum = 0;
+
+    for (long u : vertices)
+    {
+        double best_incident = 0;
+
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
+        {
+            long v = instance->graph->adj_pairs[2*k];
+            double w = instance->graph->w[instance->graph->adj_pairs[2*k + 1]];
+
+            best_incident = max(best_incident, w);
+
+            if (u < v && w > 0)
+                positive_sum += w;
+        }
+
+        half_vertex_sum += best_incident / 2;
+    }
+
+    return min(positive_sum, half_vertex_sum);
+}
+
+void WCMDecomposition::set_incumbent(const vector<bool> &edge_in_solution)
+{
+    /// use a known connected matching (e.g. a MIP start) if it is better
+
+    double weight = instance->graph->edge_subset_weight(edge_in_solution);
+
+    if (weight > solution_weight)
+    {
+        solution_weight = weight;
+        solution_vector_x = edge_in_solution;
+    }
+}
+
+void WCMDecomposition::set_matching_bound(const vector<bool> &matching)
+{
+    /***
+     * Tighten the bound of each component with the weight of a maximum weight
+     * matching (in the whole graph) restricted to it. Components where it
+     * covers a connected vertex set are thus closed without building a model.
+     */
+
+    Graph *graph = instance->graph;
+    const long n = graph->num_vertices;
+
+    // 1. MATCHING WEIGHT AND COVERED VERTICES IN EACH COMPONENT
+    vector<double> matching_weight = vector<double>(num_components, 0);
+    vector<bool> covered = vector<bool>(n, false);
+
+    for (long e = 0; e < graph->num_edges; ++e)
+    {
+        if (matching[e])
+        {
+            matching_weight[component_index[graph->s[e]]] += graph->w[e];
+            covered[graph->s[e]] = true;
+            covered[graph->t[e]] = true;
+        }
+    }
+
+    // 2. NUMBER OF CONNECTED PIECES OF COVERED VERTICES IN EACH COMPONENT
+    vector<long> num_pieces = vector<long>(num_components, 0);
+    vector<bool> seen = vector<bool>(n, false);
+    vector<long> stack;
+
+    for (long root = 0; root < n; ++root)
+    {
+        if (!covered[root] || seen[root])
+            continue;
+
+        num_pieces[component_index[root]]++;
+        seen[root] = true;
+        stack.push_back(root);
+
+        while (!stack.empty())
+        {
+            long u = stack.back();
+            stack.pop_back();
+
+            for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+            {
+                long v = graph->adj_pairs[2*k];
+                if (covered[v] && !seen[v])
+                {
+                    seen[v] = true;
+                    stack.push_back(v);
+                }
+            }
+        }
+    }
+
+    // 3. TIGHTER BOUNDS, AND COMPONENTS CLOSED BY THE MATCHING
+    long best_closed = -1;
+
+    for (long idx = 0; idx < num_components; ++idx)
+    {
+        component_bound[idx] = min(component_bound[idx], matching_weight[idx]);
+        component_dualbound[idx] = min(component_dualbound[idx],
+                                       matching_weight[idx]);
+
+        if (num_pieces[idx] <= 1)
+        {
+            ++num_closed_by_matching;
+
+            if (matching_weight[idx] > solution_weight)
+            {
+                solution_weight = matching_weight[idx];
+                best_closed = idx;
+            }
+        }
+    }
+
+    if (best_closed >= 0)
+    {
+        solution_vector_x = vector<bool>(graph->num_edges, false);
+
+        for (long e = 0; e < graph->num_edges; ++e)
+            if (matching[e] && component_index[graph->s[e]] == best_closed)
+                solution_vector_x[e] = true;
+    }
+}
+
+int WCMDecomposition::solve(bool separators_based_formulation,
+                            double time_limit,
+                            long num_threads)
+{
+    /***
+     * Solve each component (unless pruned) with the chosen formulation, using
+     * a pool of num_threads workers (0 for one per hardware thread) which take
+     * components in order of non-increasing upper bound. Returns the number of
+     * components actually solved.
+     */
+
+    this->separators_based_formulation = separators_based_formulation;
+    this->time_limit = time_limit;
+    this->next_component = 0;
+    this->solve_clock.restart();
+
+    long hardware_threads = std::thread::hardware_concurrency();
+    if (hardware_threads < 1)
+        hardware_threads = 1;
+
+    if (num_threads < 1)
+        num_threads = hardware_threads;
+
+    long num_workers = min(num_threads, max(num_components, 1L));
+    this->threads_per_model = max(1L, hardware_threads / num_workers);
+
+    // one gurobi environment per worker, started here (if not given)
+    vector<GRBEnv*> dedicated_envs;
+    vector<GRBEnv*> &envs = worker_envs ? *worker_envs : dedicated_envs;
+    num_workers = min(num_workers, add_worker_envs(envs, num_workers));
+
+    cout << "Decomposition: " << num_components << " components, "
+         << num_workers << " worker threads (" << threads_per_model
+         << " gurobi threads each)" << endl;
+
+    vector<std::thread> workers;
+    for (long i = 0; i < num_workers; ++i)
+        workers.push_back(std::thread(&WCMDecomposition::worker, this, envs[i]));
+
+    for (std::thread &t : workers)
+        t.join();
+
+    for (GRBEnv *env : dedicated_envs)
+        delete env;
+
+    this->solution_runtime = solve_clock.realTime();
+
+    // global dual bound: best over all components (incl. unsolved ones)
+    this->solution_dualbound = solution_weight;
+    for (long idx = 0; idx < num_components; ++idx)
+        solution_dualbound = max(solution_dualbound, component_dualbound[idx]);
+
+    if (solution_dualbound <= solution_weight + DECOMPOSITION_EPSILON)
+    {
+        this->solution_status = AT_OPTIMUM;
+        this->solution_dualbound = solution_weight;
+    }
+    else
+        this->solution_status = STATUS_UNKNOWN;
+
+    cout << "Decomposition: solved " << num_solved_components
+         << " components, pruned " << num_pruned_components
+         << "; best weight " << solution_weight
+         << ", dual bound " << solution_dualbound << endl;
+
+    if (!instance->graph->is_connected_matching(solution_vector_x, true))
+        cout << endl
+             << "######################" << endl
+             << "### WRONG SOLUTION ###" << endl
+             << "######################" << endl << endl;
+
+    return num_solved_components;
+}
+
+void WCMDecomposition::worker(GRBEnv *env)
+{
+    /// take components from the shared queue until none is left
+
+    try
+    {
+        // NB! the environment may have been used with other settings before
+        env->set(GRB_IntParam_OutputFlag, 0);
+        env->set(GRB_IntParam_Threads, threads_per_model);
+    }
+    catch(GRBException e)
+    {
+        cout << "Environment setup error, code = " << e.getErrorCode() << endl;
+        cout << e.getMessage() << endl;
+        return;
+    }
+
+    for (long idx = next_component++; idx < num_components; idx = next_component++)
+    {
+        {
+            std::lock_guard<std::mutex> lock(incumbent_mutex);
+
+            if (component_bound[idx] <= solution_weight + DECOMPOSITION_EPSILON)
+            {
+                ++num_pruned_components;
+                continue;
+            }
+        }
+
+        if (solve_clock.realTime() >= time_limit)
+            continue;   // keeping the component bound as its dual bound
+
+        solve_component(idx, env);
+    }
+}
+
+void WCMDecomposition::solve_component(long idx, GRBEnv *env)
+{
+    /// solve the subinstance of one component, and lift its solution
+
+    vector<long> original_edge_index;
+    IO *subinstance = instance->induced_subinstance(component_vertices[idx],
+                                                    local_index,
+                                                    original_edge_index);
+
+    double remaining_time = time_limit - solve_clock.realTime();
+
+    double weight, dualbound;
+    vector<bool> sub_x;
+    long nodes = 0, blossom = 0, msi = 0, indegree = 0;
+
+    if (separators_based_formulation)
+    {
+        WCMModel *model = new WCMModel(subinstance, env);
+        model->set_time_limit(remaining_time);
+        model->set_objective_upper_bound(component_bound[idx]);
+        model->solve(false);
+
+        weight = model->solution_weight;
+        dualbound = model->solution_dualbound;
+        sub_x = model->solution_vector_x;
+        nodes = model->get_mip_num_nodes();
+        blossom = model->get_mip_blossom_counter();
+        msi = model->get_mip_msi_counter();
+        indegree = model->get_mip_indegree_counter();
+
+        delete model;
+    }
+    else
+    {
+        CompactWCMModel *model = new CompactWCMModel(subinstance, env);
+        model->set_time_limit(remaining_time);
+        model->set_objective_upper_bound(component_bound[idx]);
+        model->solve(false);
+
+        weight = model->solution_weight;
+        dualbound = model->solution_dualbound;
+        sub_x = model->solution_vector_x;
+        nodes = model->get_mip_num_nodes();
+
+        delete model;
+    }
+
+    delete subinstance;
+
+    std::lock_guard<std::mutex> lock(incumbent_mutex);
+
+    ++num_solved_components;
+    mip_num_nodes += nodes;
+    blossom_counter += blossom;
+    msi_counter += msi;
+    indegree_counter += indegree;
+
+    // NB! models keep numeric_limits<double>::max() if nothing was found
+    if (dualbound < numeric_limits<double>::max())
+        component_dualbound[idx] = min(component_dualbound[idx], dualbound);
+
+    if (weight < numeric_limits<double>::max() && weight > solution_weight)
+    {
+        solution_weight = weight;
+        solution_vector_x = vector<bool>(instance->graph->num_edges, false);
+
+        for (unsigned long e = 0; e < sub_x.size(); ++e)
+            if (sub_x[e])
+                solution_vector_x[original_edge_index[e]] = true;
+    }
+}
+
+double WCMDecomposition::get_mip_gap()
+{
+    /// same definition as gurobi: |dual bound - primal bound| / |primal bound|
+
+    if (solution_dualbound - solution_weight <= DECOMPOSITION_EPSILON)
+        return 0;
+
+    if (fabs(solution_weight) < DECOMPOSITION_EPSILON)
+        return GRB_INFINITY;
+
+    return fabs(solution_dualbound - solution_weight) / fabs(solution_weight);
+}
+
+void WCMDecomposition::save_json_info(IO *record)
+{
+    /// save decomposition and (aggregated) mip info in the given json record
+
+    record->save_json_field("formulation", string(separators_based_formulation ?
+                                                    "separators" : "compact"));
+    record->save_json_field("decomposition_components", num_components);
+    record->save_json_field("decomposition_solved", num_solved_components);
+    record->save_json_field("decomposition_pruned", num_pruned_components);
+    record->save_json_field("decomposition_closed_by_matching",
+                            num_closed_by_matching);
+
+    record->save_json_field("status", string(solution_status == AT_OPTIMUM ?
+                                               "OPTIMAL" : "UNKNOWN"));
+    record->save_json_field("mip_primal_bound", solution_weight);
+    record->save_json_field("mip_dual_bound", solution_dualbound);
+    record->save_json_field("mip_gap", get_mip_gap());
+    record->save_json_field("mip_nodes", mip_num_nodes);
+    record->save_json_field("mip_runtime", solution_runtime);
+
+    record->save_json_field("blossom_added", blossom_counter);
+    record->save_json_field("msi_added", msi_counter);
+    record->save_json_field("indegree_added", indegree_counter);
+}
@@ -0,0 +1,90 @@
+#ifndef _WCM_DECOMPOSITION_H_
+#define _WCM_DECOMPOSITION_H_
+
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "gurobi_c++.h"
+
+#include "io.h"
+#include "wcm_model.h"
+#include "wcm_compact.h"
+
+/***
+ * \file wcm_decomposition.h
+ *
+ * Module for solving an instance component by component: a connected matching
+ * lies entirely within one connected component of the input graph, so each
+ * component may be solved independently (and concurrently, each one with its
+ * own model, cut generator and Gurobi environment). Components whose upper
+ * bound cannot beat the incumbent are skipped.
+ *
+ * The worker environments may be given (e.g. by a batch run, which then keeps
+ * them for all instances), instead of being started for each instance.
+ *
+ * \author Phillippe Samer <samer@uib.no>
+ * \date 17.10.2026
+ */
+
+class WCMDecomposition
+{
+public:
+    WCMDecomposition(IO*, vector<GRBEnv*>* = NULL);
+    virtual ~WCMDecomposition();
+
+    long num_components;          // with at least one edge
+    long num_pruned_components;   // not solved, as they cannot beat incumbent
+    long num_solved_components;
+    long num_closed_by_matching;  // optimum given by a max weight matching
+
+    void set_incumbent(const vector<bool> &);
+    void set_matching_bound(const vector<bool> &);
+    int solve(bool, double, long);
+
+    double solution_weight;
+    double solution_dualbound;
+    vector<bool> solution_vector_x;   // edge in matching or not
+    ModelStatus solution_status;
+    double solution_runtime;
+
+    // further info (summed over all components solved)
+    double get_mip_gap();
+    long mip_num_nodes;
+    long blossom_counter;
+    long msi_counter;
+    long indegree_counter;
+
+    void save_json_info(IO*);
+
+protected:
+    IO *instance;
+    vector<GRBEnv*> *worker_envs;   // shared, not deleted with this object
+
+    // nontrivial components, by non-increasing upper bound
+    vector< vector<long> > component_vertices;
+    vector<double> component_bound;
+    vector<double> component_dualbound;
+    vector<long> local_index;
+    vector<long> component_index;   // of each vertex (-1 if in no component)
+
+    double component_upper_bound(const vector<long> &);
+
+    // shared state among worker threads
+    std::mutex incumbent_mutex;
+    std::atomic<long> next_component;
+    bool separators_based_formulation;
+    double time_limit;
+    long threads_per_model;
+    Timer solve_clock;
+
+    void worker(GRBEnv *);
+    void solve_component(long, GRBEnv *);
+};
+
+#endif
@@ -0,0 +1,1047 @@
+#include "wcm_heuristic.h"
+
+// relaxation values below this are taken as zero in lp rounding
+const double ROUNDING_EPSILON = 1e-5;
+
+// local search stops after this many passes (or when no move improves)
+const long LOCAL_SEARCH_MAX_PASSES = 5;
+const double LOCAL_SEARCH_EPSILON = 1e-9;
+
+WCMHeuristic::WCMHeuristic(IO *instance)
+{
+    this->instance = instance;
+
+    this->greedy_weight = 0;
+    this->greedy_runtime = -1;
+    this->greedy_seeds = 0;
+
+    this->tree_dp_weight = 0;
+    this->tree_dp_runtime = -1;
+    this->tree_dp_trees = 0;
+
+    const long n = instance->graph->num_vertices;
+
+    this->covered = vector<bool>(n, false);
+    this->touched = vector<bool>(n, false);
+    this->chosen_weight = 0;
+
+    // no components (of a rounded matching) unless lp rounding is running
+    this->component = vector<long>(n, -1);
+    this->adjacent_components_weight = vector<double>(n, 0);
+    this->gain_stamp = -1;
+
+    this->visit_stamp = vector<long>(n, -1);
+    this->visit_counter = -1;
+}
+
+WCMHeuristic::~WCMHeuristic()
+{
+    covered.clear();
+    touched.clear();
+    component.clear();
+    adjacent_components_weight.clear();
+    visit_stamp.clear();
+}
+
+double WCMHeuristic::greedy_connected_matching(vector<bool> &edge_in_solution,
+                                               long max_seeds)
+{
+    /***
+     * Best connected matching grown greedily from each of the max_seeds
+     * heaviest edges. Each run takes O(m log m) time, as every edge enters the
+     * priority queue at most twice (once per endpoint becoming touched).
+     * Returns its weight (0 for the empty matching, if no edge is positive).
+     */
+
+    Timer heuristic_clock;
+    Graph *graph = instance->graph;
+
+    // 1. SEEDS: HEAVIEST POSITIVE EDGES
+    vector<long> seeds;
+    for (long e = 0; e < graph->num_edges; ++e)
+        if (graph->w[e] > 0)
+            seeds.push_back(e);
+
+    long k = min(max_seeds, (long) seeds.size());
+    partial_sort(seeds.begin(), seeds.begin() + k, seeds.end(),
+                 [graph](long a, long b) { return graph->w[a] > graph->w[b]; });
+    seeds.resize(k);
+
+    // 2. GROW A CONNECTED MATCHING FROM EACH SEED, KEEPING THE BEST ONE
+    vector<long> best_edges;
+    this->greedy_weight = 0;
+    this->greedy_seeds = k;
+
+    for (long seed : seeds)
+    {
+        double weight = grow_from_seed(seed);
+
+        if (weight > greedy_weight)
+        {
+            greedy_weight = weight;
+            best_edges = chosen_edges;
+        }
+    }
+
+    edge_in_solution = vector<bool>(graph->num_edges, false);
+    for (long e : best_edges)
+        edge_in_solution[e] = true;
+
+    this->greedy_runtime = heuristic_clock.realTime();
+
+    cout << "Greedy heuristic: connected matching of weight " << greedy_weight
+         << " (" << best_edges.size() << " edges, " << k << " seeds) in "
+         << greedy_runtime << " s" << endl;
+
+    return greedy_weight;
+}
+
+double WCMHeuristic::lp_rounding(const double *x_val,
+                                 vector<bool> &edge_in_solution)
+{
+    /***
+     * Connected matching from a (fractional) point x_val of the relaxation:
+     * 1. greedy matching in non-increasing order of x_val;
+     * 2. its heaviest component (among those of positive weight) is kept, and
+     * other components are merged into it through connector edges, i.e.
+     * edges uv with both ends uncovered, and u adjacent to the solution - the
+     * gain of uv is its weight plus that of the components adjacent to u or v;
+     * 3. positive edges are added greedily, as in greedy_connected_matching.
+     * Steps 2 and 3 share the same priority queue (on the gain of each edge),
+     * where gains only decrease as components are merged, so they are updated
+     * lazily (the weight of components adjacent to each vertex is kept up to
+     * date as they merge). Returns the weight of the solution (0 if none was found).
+     */
+
+    Graph *graph = instance->graph;
+
+    long num_components = round_relaxation(x_val);
+
+    // 1. START FROM THE HEAVIEST COMPONENT OF POSITIVE WEIGHT
+    long heaviest = -1;
+    for (long c = 0; c < num_components; ++c)
+        if (!component_merged[c] &&
+            (heaviest < 0 || component_weight[c] > component_weight[heaviest]))
+            heaviest = c;
+
+    chosen_edges.clear();
+    chosen_weight = 0;
+
+    if (heaviest >= 0)
+    {
+        component_merged[heaviest] = true;
+        pending_components.push_back(heaviest);
+        merge_pending_components();
+
+        // 2. CONNECTOR EDGES AND FURTHER GREEDY EXTENSION
+        grow_greedily();
+    }
+
+    edge_in_solution = vector<bool>(graph->num_edges, false);
+    for (long e : chosen_edges)
+        edge_in_solution[e] = true;
+
+    // restore scratch structures
+    for (long u : touched_vertices)
+        touched[u] = false;
+    touched_vertices.clear();
+
+    for (long e : chosen_edges)
+        covered[graph->s[e]] = covered[graph->t[e]] = false;
+
+    fill(component.begin(), component.end(), -1);
+    fill(adjacent_components_weight.begin(), adjacent_components_weight.end(), 0);
+    component_weight.clear();
+    component_edges.clear();
+    component_merged.clear();
+    component_stamp.clear();
+
+    return chosen_weight;
+}
+
+long WCMHeuristic::round_relaxation(const double *x_val)
+{
+    /***
+     * Greedy matching in the order of x_val, and its connected components in
+     * the graph (where components of nonpositive weight are discarded). Also
+     * sets adjacent_components_weight. Returns the number of components.
+     */
+
+    Graph *graph = instance->graph;
+    const long n = graph->num_vertices;
+
+    // 1. GREEDY MATCHING IN THE SUPPORT OF x_val (MARKING COVERED WITH -2)
+    vector<long> support;
+    for (long e = 0; e < graph->num_edges; ++e)
+        if (x_val[e] > ROUNDING_EPSILON)
+            support.push_back(e);
+
+    sort(support.begin(), support.end(),
+         [graph, x_val](long a, long b)
+         {
+             if (x_val[a] != x_val[b])
+                 return x_val[a] > x_val[b];
+             return graph->w[a] > graph->w[b];
+         });
+
+    vector<long> rounded_edges;
+    for (long e : support)
+    {
+        if (component[graph->s[e]] == -1 && component[graph->t[e]] == -1)
+        {
+            component[graph->s[e]] = component[graph->t[e]] = -2;
+            rounded_edges.push_back(e);
+        }
+    }
+
+    // 2. CONNECTED COMPONENTS OF COVERED VERTICES
+    long num_components = 0;
+    vector<long> stack;
+
+    for (long e : rounded_edges)
+    {
+        long root = graph->s[e];
+        if (component[root] != -2)
+            continue;
+
+        component[root] = num_components;
+        stack.push_back(root);
+
+        while (!stack.empty())
+        {
+            long u = stack.back();
+            stack.pop_back();
+
+            for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+            {
+                long v = graph->adj_pairs[2*k];
+                if (component[v] == -2)
+                {
+                    component[v] = num_components;
+                    stack.push_back(v);
+                }
+            }
+        }
+
+        ++num_components;
+    }
+
+    component_weight = vector<double>(num_components, 0);
+    component_edges = vector< vector<long> >(num_components);
+    component_merged = vector<bool>(num_components, false);
+    component_stamp = vector<long>(num_components, -1);
+
+    for (long e : rounded_edges)
+    {
+        long c = component[graph->s[e]];
+        component_weight[c] += graph->w[e];
+        component_edges[c].push_back(e);
+    }
+
+    // 3. DISCARD COMPONENTS THAT DO NOT PAY OFF (NB! FLAGGED AS MERGED)
+    for (long e : rounded_edges)
+    {
+        long c = component[graph->s[e]];
+        if (component_weight[c] <= 0)
+        {
+            component_merged[c] = true;
+            component[graph->s[e]] = component[graph->t[e]] = -1;
+        }
+    }
+
+    // 4. WEIGHT OF DISTINCT COMPONENTS ADJACENT TO EACH UNCOVERED VERTEX
+    for (long u = 0; u < n; ++u)
+    {
+        if (component[u] >= 0)
+            continue;
+
+        for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+        {
+            long c = component[graph->adj_pairs[2*k]];
+            if (c >= 0 && component_stamp[c] != u)
+            {
+                component_stamp[c] = u;
+                adjacent_components_weight[u] += component_weight[c];
+            }
+        }
+    }
+
+    fill(component_stamp.begin(), component_stamp.end(), -1);
+    gain_stamp = -1;
+
+    return num_components;
+}
+
+double WCMHeuristic::connector_gain(long e)
+{
+    /// weight of e plus that of components not merged yet, adjacent to its ends
+
+    Graph *graph = instance->graph;
+    double gain = graph->w[e];
+
+    ++gain_stamp;
+
+    for (long x : {graph->s[e], graph->t[e]})
+    {
+        for (long k = graph->adj_offset[x]; k < graph->adj_offset[x+1]; ++k)
+        {
+            long c = component[graph->adj_pairs[2*k]];
+            if (c >= 0 && !component_merged[c] &&
+                component_stamp[c] != gain_stamp)
+            {
+                component_stamp[c] = gain_stamp;
+                gain += component_weight[c];
+            }
+        }
+    }
+
+    return gain;
+}
+
+void WCMHeuristic::merge_pending_components()
+{
+    /// add the edges of components reached by the solution (maybe cascading)
+
+    Graph *graph = instance->graph;
+
+    while (!pending_components.empty())
+    {
+        long c = pending_components.back();
+        pending_components.pop_back();
+
+        // c no longer adds to the gain of edges at vertices adjacent to it
+        ++visit_counter;
+        for (long e : component_edges[c])
+        {
+            for (long x : {graph->s[e], graph->t[e]})
+            {
+                for (long k = graph->adj_offset[x];
+                     k < graph->adj_offset[x+1]; ++k)
+                {
+                    long y = graph->adj_pairs[2*k];
+                    if (component[y] < 0 && visit_stamp[y] != visit_counter)
+                    {
+                        visit_stamp[y] = visit_counter;
+                        adjacent_components_weight[y] -= component_weight[c];
+                    }
+                }
+            }
+        }
+
+        for (long e : component_edges[c])
+            cover_edge(e);
+    }
+}
+
+double WCMHeuristic::grow_from_seed(long seed)
+{
+    /// greedy connected matching containing the seed edge (in chosen_edges)
+
+    Graph *graph = instance->graph;
+
+    chosen_edges.clear();
+    chosen_weight = 0;
+
+    cover_edge(seed);
+    grow_greedily();
+
+    // restore scratch structures (in time proportional to what was visited)
+    for (long u : touched_vertices)
+        touched[u] = false;
+    touched_vertices.clear();
+
+    for (long e : chosen_edges)
+        covered[graph->s[e]] = covered[graph->t[e]] = false;
+
+    return chosen_weight;
+}
+
+void WCMHeuristic::grow_greedily()
+{
+    /// add the candidate edge of largest gain, while some gain is positive
+
+    Graph *graph = instance->graph;
+
+    while (!candidate_edges.empty())
+    {
+        double key = candidate_edges.top().first;
+        long e = candidate_edges.top().second;
+        candidate_edges.pop();
+
+        // NB! an edge may have been queued before one of its ends got covered
+        if (covered[graph->s[e]] || covered[graph->t[e]])
+            continue;
+
+        // queued gains are upper bounds, updated when popped (lp rounding only)
+        // NB! the estimate counts twice a component adjacent to both ends, so
+        // the exact gain is only computed for the best candidate
+        if (!component_weight.empty())
+        {
+            double gain = graph->w[e]
+                        + adjacent_components_weight[graph->s[e]]
+                        + adjacent_components_weight[graph->t[e]];
+
+            if (gain >= key)
+                gain = connector_gain(e);
+
+            if (gain < key)
+            {
+                if (gain > 0)
+                    candidate_edges.push(make_pair(gain, e));
+                continue;
+            }
+        }
+
+        cover_edge(e);
+        merge_pending_components();
+    }
+}
+
+void inline WCMHeuristic::cover_edge(long e)
+{
+    /// add edge e to the matching, making the neighbours of its ends reachable
+
+    Graph *graph = instance->graph;
+
+    chosen_edges.push_back(e);
+    chosen_weight += graph->w[e];
+    covered[graph->s[e]] = true;
+    covered[graph->t[e]] = true;
+
+    for (long x : {graph->s[e], graph->t[e]})
+        for (long k = graph->adj_offset[x]; k < graph->adj_offset[x+1]; ++k)
+            touch_vertex(graph->adj_pairs[2*k]);
+}
+
+void inline WCMHeuristic::touch_vertex(long u)
+{
+    /***
+     * u is adjacent to a covered vertex: if it lies in a component (of a
+     * rounded matching), that component joins the solution; otherwise, edges
+     * to uncovered vertices outside components may be added now.
+     */
+
+    if (covered[u] || touched[u])
+        return;
+
+    if (component[u] >= 0)
+    {
+        if (!component_merged[component[u]])
+        {
+            component_merged[component[u]] = true;
+            pending_components.push_back(component[u]);
+        }
+        return;
+    }
+
+    Graph *graph = instance->graph;
+
+    touched[u] = true;
+    touched_vertices.push_back(u);
+
+    for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+    {
+        long v = graph->adj_pairs[2*k];
+        long e = graph->adj_pairs[2*k + 1];
+
+        if (covered[v] || component[v] >= 0)
+            continue;
+
+        double key = graph->w[e] + adjacent_components_weight[u]
+                                 + adjacent_components_weight[v];
+        if (key > 0)
+            candidate_edges.push(make_pair(key, e));
+    }
+}
+
+double WCMHeuristic::local_search(vector<bool> &edge_in_solution)
+{
+    /***
+     * First-improvement local search from a connected matching, with moves:
+     * - add: positive edges with both ends uncovered and one of them adjacent
+     * to the solution (greedily, as in greedy_connected_matching);
+     * - drop: an edge of negative weight, if the other covered vertices remain
+     * connected without its ends;
+     * - swap: replace uv by a heavier edge ux, with x uncovered, if covered
+     * vertices remain connected without v.
+     * Passes repeat while some move improves (up to LOCAL_SEARCH_MAX_PASSES).
+     * The solution is updated in place, and its weight is returned.
+     */
+
+    Graph *graph = instance->graph;
+
+    chosen_edges.clear();
+    chosen_weight = 0;
+
+    for (long e = 0; e < graph->num_edges; ++e)
+    {
+        if (edge_in_solution[e])
+        {
+            chosen_edges.push_back(e);
+            chosen_weight += graph->w[e];
+            covered[graph->s[e]] = covered[graph->t[e]] = true;
+        }
+    }
+
+    for (long pass = 0; pass < LOCAL_SEARCH_MAX_PASSES; ++pass)
+    {
+        double weight_before = chosen_weight;
+
+        // 1. ADD MOVES (NB! cover_edge extends chosen_edges)
+        long num_chosen = chosen_edges.size();
+        for (long i = 0; i < num_chosen; ++i)
+        {
+            long e = chosen_edges[i];
+            for (long x : {graph->s[e], graph->t[e]})
+                for (long k = graph->adj_offset[x];
+                     k < graph->adj_offset[x+1]; ++k)
+                    touch_vertex(graph->adj_pairs[2*k]);
+        }
+
+        grow_greedily();
+
+        for (long u : touched_vertices)
+            touched[u] = false;
+        touched_vertices.clear();
+
+        // 2. DROP AND SWAP MOVES
+        for (unsigned long i = 0; i < chosen_edges.size(); ++i)
+        {
+            long e = chosen_edges[i];
+            long u = graph->s[e];
+            long v = graph->t[e];
+
+            if (graph->w[e] < 0 && connected_after_move(u, v, -1))
+            {
+                covered[u] = covered[v] = false;
+                chosen_weight -= graph->w[e];
+                chosen_edges[i] = chosen_edges.back();
+                chosen_edges.pop_back();
+                --i;
+                continue;
+            }
+
+            // heaviest edge ax replacing e = ab, with x uncovered
+            long best_edge = -1, released = -1, added = -1;
+            for (long a : {u, v})
+            {
+                for (long k = graph->adj_offset[a];
+                     k < graph->adj_offset[a+1]; ++k)
+                {
+                    long x = graph->adj_pairs[2*k];
+                    long f = graph->adj_pairs[2*k + 1];
+
+                    if (covered[x] ||
+                        graph->w[f] <= graph->w[e] + LOCAL_SEARCH_EPSILON)
+                        continue;
+
+                    if (best_edge < 0 || graph->w[f] > graph->w[best_edge])
+                    {
+                        best_edge = f;
+                        released = (a == u) ? v : u;
+                        added = x;
+                    }
+                }
+            }
+
+            if (best_edge >= 0 && connected_after_move(released, -1, added))
+            {
+                covered[released] = false;
+                covered[added] = true;
+                chosen_weight += graph->w[best_edge] - graph->w[e];
+                chosen_edges[i] = best_edge;
+            }
+        }
+
+        if (chosen_weight <= weight_before + LOCAL_SEARCH_EPSILON)
+            break;
+    }
+
+    edge_in_solution = vector<bool>(graph->num_edges, false);
+    for (long e : chosen_edges)
+    {
+        edge_in_solution[e] = true;
+        covered[graph->s[e]] = covered[graph->t[e]] = false;
+    }
+
+    return chosen_weight;
+}
+
+double WCMHeuristic::random_restart(vector<bool> &edge_in_solution,
+                                    mt19937 &rng)
+{
+    /// greedy connected matching from a random positive edge, improved by ls
+
+    Graph *graph = instance->graph;
+
+    if (positive_edges.empty())
+        for (long e = 0; e < graph->num_edges; ++e)
+            if (graph->w[e] > 0)
+                positive_edges.push_back(e);
+
+    edge_in_solution = vector<bool>(graph->num_edges, false);
+
+    if (positive_edges.empty())
+        return 0;
+
+    long seed = positive_edges[rng() % positive_edges.size()];
+    grow_from_seed(seed);
+
+    for (long e : chosen_edges)
+        edge_in_solution[e] = true;
+
+    return local_search(edge_in_solution);
+}
+
+double WCMHeuristic::perturb(vector<bool> &edge_in_solution,
+                             mt19937 &rng,
+                             long strength)
+{
+    /***
+     * Kick for iterated local search: drop strength random edges of a
+     * connected matching, and add strength random edges (of any weight) with
+     * both ends uncovered, one of them adjacent to a covered vertex. The result
+     * is then repaired as in lp rounding (heaviest connected part, merged with
+     * the others through connector edges, and extended greedily).
+     */
+
+    Graph *graph = instance->graph;
+
+    vector<long> edges;
+    for (long e = 0; e < graph->num_edges; ++e)
+        if (edge_in_solution[e])
+            edges.push_back(e);
+
+    // 1. DROP RANDOM EDGES
+    for (long i = 0; i < strength && !edges.empty(); ++i)
+    {
+        long pos = rng() % edges.size();
+        edge_in_solution[edges[pos]] = false;
+        edges[pos] = edges.back();
+        edges.pop_back();
+    }
+
+    for (long e : edges)
+        covered[graph->s[e]] = covered[graph->t[e]] = true;
+
+    // 2. ADD RANDOM EDGES NEXT TO THE SOLUTION (uv with u adjacent to c)
+    for (long i = 0; i < strength && !edges.empty(); ++i)
+    {
+        long e = edges[rng() % edges.size()];
+        long c = (rng() % 2) ? graph->s[e] : graph->t[e];
+
+        long c_degree = graph->adj_offset[c+1] - graph->adj_offset[c];
+        long u = graph->adj_pairs[2*(graph->adj_offset[c] + rng() % c_degree)];
+        if (covered[u])
+            continue;
+
+        long u_degree = graph->adj_offset[u+1] - graph->adj_offset[u];
+        long k = graph->adj_offset[u] + rng() % u_degree;
+        long v = graph->adj_pairs[2*k];
+        if (covered[v])
+            continue;
+
+        long f = graph->adj_pairs[2*k + 1];
+        edge_in_solution[f] = true;
+        edges.push_back(f);
+        covered[u] = covered[v] = true;
+    }
+
+    for (long e : edges)
+        covered[graph->s[e]] = covered[graph->t[e]] = false;
+
+    // 3. REPAIR
+    vector<double> x_val = vector<double>(graph->num_edges, 0);
+    for (long e : edges)
+        x_val[e] = 1;
+
+    return lp_rounding(x_val.data(), edge_in_solution);
+}
+
+bool WCMHeuristic::connected_after_move(long removed_1,
+                                        long removed_2,
+                                        long added)
+{
+    /***
+     * Check if covered vertices remain connected after uncovering removed_1
+     * and removed_2, and covering added (each one ignored if -1), by a search
+     * restricted to covered vertices. Restores the covered flags afterwards.
+     */
+
+    Graph *graph = instance->graph;
+
+    for (long x : {removed_1, removed_2})
+        if (x >= 0)
+            covered[x] = false;
+    if (added >= 0)
+        covered[added] = true;
+
+    // number of covered vertices and a starting point
+    long expected = 0, root = -1;
+    for (long e : chosen_edges)
+        for (long x : {graph->s[e], graph->t[e]})
+            if (covered[x])
+            {
+                ++expected;
+                root = x;
+            }
+
+    if (added >= 0)
+    {
+        ++expected;
+        root = added;
+    }
+
+    long reached = 0;
+    if (root >= 0)
+    {
+        ++visit_counter;
+        vector<long> stack;
+        stack.push_back(root);
+        visit_stamp[root] = visit_counter;
+
+        while (!stack.empty())
+        {
+            long u = stack.back();
+            stack.pop_back();
+            ++reached;
+
+            for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+            {
+                long v = graph->adj_pairs[2*k];
+                if (covered[v] && visit_stamp[v] != visit_counter)
+                {
+                    visit_stamp[v] = visit_counter;
+                    stack.push_back(v);
+                }
+            }
+        }
+    }
+
+    for (long x : {removed_1, removed_2})
+        if (x >= 0)
+            covered[x] = true;
+    if (added >= 0)
+        covered[added] = false;
+
+    return (reached == expected);
+}
+
+double WCMHeuristic::spanning_tree_dp(vector<bool> &edge_in_solution,
+                                      long num_bfs_trees,
+                                      long num_threads)
+{
+    /***
+     * Best connected matching within one of several spanning trees (forests,
+     * if the graph is disconnected): a maximum weight one, and breadth-first
+     * search trees rooted at the num_bfs_trees vertices with largest sum of
+     * positive incident weights. Trees are built and solved in parallel, by
+     * num_threads threads (0 for one per hardware thread). Takes O(m log m)
+     * time overall for the maximum spanning tree, and O(m) for each other one.
+     */
+
+    Timer heuristic_clock;
+    Graph *graph = instance->graph;
+    const long n = graph->num_vertices;
+
+    // 1. ROOTS OF BFS TREES: HEAVIEST VERTICES
+    vector<double> vertex_weight = vector<double>(n, 0);
+    for (long e = 0; e < graph->num_edges; ++e)
+    {
+        if (graph->w[e] > 0)
+        {
+            vertex_weight[graph->s[e]] += graph->w[e];
+            vertex_weight[graph->t[e]] += graph->w[e];
+        }
+    }
+
+    vector<long> roots;
+    for (long u = 0; u < n; ++u)
+        if (vertex_weight[u] > 0)
+            roots.push_back(u);
+
+    long k = min(num_bfs_trees, (long) roots.size());
+    partial_sort(roots.begin(), roots.begin() + k, roots.end(),
+                 [&vertex_weight](long a, long b)
+                 { return vertex_weight[a] > vertex_weight[b]; });
+    roots.resize(k);
+
+    // 2. ONE TASK PER TREE (-1 FOR THE MAXIMUM SPANNING TREE)
+    roots.insert(roots.begin(), -1);
+
+    if (num_threads < 1)
+        num_threads = std::thread::hardware_concurrency();
+    num_threads = max(1L, min(num_threads, (long) roots.size()));
+
+    std::atomic<long> next_task(0);
+    std::mutex best_mutex;
+    vector<long> best_edges;
+    this->tree_dp_weight = 0;
+
+    auto worker = [&]()
+    {
+        vector<long> parent_edge, order, tree_solution;
+
+        for (long task = next_task++; task < (long) roots.size();
+             task = next_task++)
+        {
+            if (roots[task] < 0)
+                maximum_spanning_forest(parent_edge, order);
+            else
+                root_forest(NULL, roots[task], parent_edge, order);
+
+            double weight = tree_dp(parent_edge, order, tree_solution);
+
+            std::lock_guard<std::mutex> lock(best_mutex);
+            if (weight > tree_dp_weight)
+            {
+                tree_dp_weight = weight;
+                best_edges = tree_solution;
+            }
+        }
+    };
+
+    vector<std::thread> workers;
+    for (long i = 0; i < num_threads; ++i)
+        workers.push_back(std::thread(worker));
+
+    for (std::thread &t : workers)
+        t.join();
+
+    edge_in_solution = vector<bool>(graph->num_edges, false);
+    for (long e : best_edges)
+        edge_in_solution[e] = true;
+
+    this->tree_dp_trees = roots.size();
+    this->tree_dp_runtime = heuristic_clock.realTime();
+
+    cout << "Spanning tree heuristic: connected matching of weight "
+         << tree_dp_weight << " (" << best_edges.size() << " edges, "
+         << tree_dp_trees << " trees) in " << tree_dp_runtime << " s" << endl;
+
+    return tree_dp_weight;
+}
+
+void WCMHeuristic::maximum_spanning_forest(vector<long> &parent_edge,
+                                           vector<long> &order) const
+{
+    /// kruskal's algorithm (with union-find), rooting each tree afterwards
+
+    Graph *graph = instance->graph;
+    const long n = graph->num_vertices;
+
+    vector<long> edges = vector<long>(graph->num_edges);
+    for (long e = 0; e < graph->num_edges; ++e)
+        edges[e] = e;
+
+    sort(edges.begin(), edges.end(),
+         [graph](long a, long b) { return graph->w[a] > graph->w[b]; });
+
+    vector<long> leader = vector<long>(n);
+    for (long u = 0; u < n; ++u)
+        leader[u] = u;
+
+    auto find = [&leader](long u)
+    {
+        while (leader[u] != u)
+        {
+            leader[u] = leader[leader[u]];   // path halving
+            u = leader[u];
+        }
+        return u;
+    };
+
+    vector<bool> in_tree = vector<bool>(graph->num_edges, false);
+    for (long e : edges)
+    {
+        long a = find(graph->s[e]);
+        long b = find(graph->t[e]);
+
+        if (a != b)
+        {
+            leader[a] = b;
+            in_tree[e] = true;
+        }
+    }
+
+    root_forest(&in_tree, 0, parent_edge, order);
+}
+
+void WCMHeuristic::root_forest(const vector<bool> *in_tree,
+                               long first_root,
+                               vector<long> &parent_edge,
+                               vector<long> &order) const
+{
+    /***
+     * Breadth-first search forest using only edges in in_tree (or any edge,
+     * if NULL), starting at first_root and then at any vertex not reached yet.
+     * Sets the edge to the parent of each vertex (-1 at roots), and an order
+     * of the vertices where parents come first.
+     */
+
+    Graph *graph = instance->graph;
+    const long n = graph->num_vertices;
+
+    vector<bool> reached = vector<bool>(n, false);
+    parent_edge = vector<long>(n, -1);
+    order.clear();
+    order.reserve(n);
+
+    for (long i = -1; i < n; ++i)
+    {
+        long root = (i < 0) ? first_root : i;
+        if (reached[root])
+            continue;
+
+        reached[root] = true;
+        order.push_back(root);
+
+        for (unsigned long head = order.size() - 1; head < order.size(); ++head)
+        {
+            long u = order[head];
+
+            for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+            {
+                long v = graph->adj_pairs[2*k];
+                long e = graph->adj_pairs[2*k + 1];
+
+                if (!reached[v] && (!in_tree || (*in_tree)[e]))
+                {
+                    reached[v] = true;
+                    parent_edge[v] = e;
+                    order.push_back(v);
+                }
+            }
+        }
+    }
+}
+
+double WCMHeuristic::tree_dp(const vector<long> &parent_edge,
+                             const vector<long> &order,
+                             vector<long> &tree_solution) const
+{
+    /***
+     * Maximum weight connected matching in a rooted forest, in linear time.
+     * For each vertex v, considering solutions whose covered vertices include
+     * v and otherwise lie below it:
+     * - B[v] is the best weight with v still uncovered (to be matched to its
+     * parent), i.e. B[v] = sum over children c of max(0, A[c]);
+     * - A[v] is the best weight with v matched to one of its children, i.e.
+     * A[v] = B[v] + max over children c of (B[c] + w(vc) - max(0, A[c])).
+     * The optimum is the largest A[v] (or the empty matching, if negative).
+     */
+
+    Graph *graph = instance->graph;
+    const long n = graph->num_vertices;
+    const double minus_infinity = -numeric_limits<double>::max();
+
+    vector<double> A = vector<double>(n, minus_infinity);
+    vector<double> B = vector<double>(n, 0);
+    vector<double> best_delta = vector<double>(n, minus_infinity);
+    vector<long> matched_child = vector<long>(n, -1);
+
+    // 1. BOTTOM-UP: CHILDREN BEFORE PARENTS
+    for (long i = n-1; i >= 0; --i)
+    {
+        long v = order[i];
+
+        if (matched_child[v] >= 0)
+            A[v] = B[v] + best_delta[v];
+
+        long e = parent_edge[v];
+        if (e < 0)
+            continue;
+
+        long p = (graph->s[e] == v) ? graph->t[e] : graph->s[e];
+        double v_alone = max(0.0, A[v]);
+
+        B[p] += v_alone;
+
+        double delta = B[v] + graph->w[e] - v_alone;
+        if (matched_child[p] < 0 || delta > best_delta[p])
+        {
+            best_delta[p] = delta;
+            matched_child[p] = v;
+        }
+    }
+
+    // 2. BEST TOPMOST VERTEX
+    long top = -1;
+    for (long v = 0; v < n; ++v)
+        if (A[v] > 0 && (top < 0 || A[v] > A[top]))
+            top = v;
+
+    tree_solution.clear();
+    if (top < 0)
+        return 0;
+
+    // 3. TOP-DOWN: RECOVER THE SOLUTION (CHILDREN GROUPED BY PARENT)
+    vector<long> first_child = vector<long>(n + 1, 0);
+    vector<long> children = vector<long>(n);
+
+    vector<long> parent = vector<long>(n, -1);
+
+    for (long v = 0; v < n; ++v)
+    {
+        long e = parent_edge[v];
+        if (e >= 0)
+        {
+            parent[v] = (graph->s[e] == v) ? graph->t[e] : graph->s[e];
+            first_child[parent[v]]++;
+        }
+    }
+
+    for (long v = 0; v < n; ++v)
+        first_child[v+1] += first_child[v];
+
+    for (long v = n-1; v >= 0; --v)
+        if (parent[v] >= 0)
+            children[--first_child[parent[v]]] = v;
+
+    // stack of (vertex, matched to a child or not)
+    vector< pair<long, bool> > stack;
+    stack.push_back(make_pair(top, true));
+
+    while (!stack.empty())
+    {
+        long v = stack.back().first;
+        bool matched_below = stack.back().second;
+        stack.pop_back();
+
+        long partner = matched_below ? matched_child[v] : -1;
+
+        if (partner >= 0)
+        {
+            tree_solution.push_back(parent_edge[partner]);
+            stack.push_back(make_pair(partner, false));
+        }
+
+        for (long k = first_child[v]; k < first_child[v+1]; ++k)
+        {
+            long c = children[k];
+            if (c != partner && A[c] > 0)
+                stack.push_back(make_pair(c, true));
+        }
+    }
+
+    return A[top];
+}
+
+void WCMHeuristic::save_json_info(IO *record)
+{
+    /// save heuristic info in the json record
+
+    if (greedy_runtime >= 0)
+    {
+        record->save_json_field("greedy_weight", greedy_weight);
+        record->save_json_field("greedy_seeds", greedy_seeds);
+        record->save_json_field("greedy_runtime", greedy_runtime);
+    }
+
+    if (tree_dp_runtime >= 0)
+    {
+        record->save_json_field("tree_dp_weight", tree_dp_weight);
+        record->save_json_field("tree_dp_trees", tree_dp_trees);
+        record->save_json_field("tree_dp_runtime", tree_dp_runtime);
+    }
+}
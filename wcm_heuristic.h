@@ -0,0 +1,106 @@
+#ifndef _WCM_HEURISTIC_H_
+#define _WCM_HEURISTIC_H_
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <random>
+#include <limits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "io.h"
+
+/***
+ * \file wcm_heuristic.h
+ *
+ * Module for primal heuristics exploiting the structure of connected
+ * matchings, whose solutions are used as MIP starts. The greedy constructive
+ * heuristic grows a matching from each of the heaviest edges, adding at each
+ * step the heaviest positive edge with both ends uncovered and at least one of
+ * them adjacent to a covered vertex (so covered vertices remain connected).
+ * The LP rounding heuristic takes a greedy matching in the order of a
+ * relaxation solution, and repairs connectivity from its heaviest component
+ * through connector edges that merge other components into it. The local
+ * search improves a connected matching by adding, dropping and swapping edges,
+ * and random restarts and perturbations support iterated local search.
+ * Finally, a connected matching using only edges of a spanning tree is also
+ * connected in the graph, and the best one in a tree is found by a linear-time
+ * dynamic program: this is solved for several spanning trees, in parallel.
+ *
+ * \author Phillippe Samer <samer@uib.no>
+ * \date 17.10.2026
+ */
+
+class WCMHeuristic
+{
+public:
+    WCMHeuristic(IO*);
+    virtual ~WCMHeuristic();
+
+    double greedy_connected_matching(vector<bool> &, long);
+    double lp_rounding(const double *, vector<bool> &);
+    double local_search(vector<bool> &);
+    double random_restart(vector<bool> &, mt19937 &);
+    double perturb(vector<bool> &, mt19937 &, long);
+
+    double spanning_tree_dp(vector<bool> &, long, long);
+
+    double greedy_weight;
+    double greedy_runtime;
+    long greedy_seeds;
+
+    double tree_dp_weight;
+    double tree_dp_runtime;
+    long tree_dp_trees;
+
+    void save_json_info(IO*);
+
+protected:
+    IO *instance;
+
+    // current partial solution, reset after each seed
+    vector<bool> covered;
+    vector<bool> touched;                   // adjacent to a covered vertex
+    vector<long> touched_vertices;
+    vector<long> chosen_edges;
+    double chosen_weight;
+    priority_queue< pair<double, long> > candidate_edges;
+
+    double grow_from_seed(long);
+    void grow_greedily();
+    void cover_edge(long);
+    void touch_vertex(long);
+
+    // lp rounding: components of the rounded matching, merged when reached
+    vector<long> component;                 // of each vertex (-1 if uncovered)
+    vector<double> component_weight;
+    vector< vector<long> > component_edges;
+    vector<bool> component_merged;
+    vector<long> component_stamp;
+    long gain_stamp;
+    vector<double> adjacent_components_weight;  // of those not merged yet
+    vector<long> pending_components;
+
+    long round_relaxation(const double *);
+    double connector_gain(long);
+    void merge_pending_components();
+
+    vector<long> positive_edges;            // seeds for random restarts
+
+    // local search: connectivity of covered vertices after a tentative move
+    vector<long> visit_stamp;
+    long visit_counter;
+    bool connected_after_move(long, long, long);
+
+    // spanning trees (rooted forests, actually) and tree dp: thread-safe
+    void maximum_spanning_forest(vector<long> &, vector<long> &) const;
+    void root_forest(const vector<bool> *, long,
+                     vector<long> &, vector<long> &) const;
+    double tree_dp(const vector<long> &, const vector<long> &,
+                   vector<long> &) const;
+};
+
+#endif
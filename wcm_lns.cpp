@@ -0,0 +1,345 @@
+#include "wcm_lns.h"
+
+// neighbourhoods: vertices within 1, 2, ..., LNS_MAX_HOPS hops of the
+// incumbent (starting over from 1 hop after each improvement), keeping at most
+// LNS_MAX_VERTICES of them (ties at the last level are broken at random)
+const long LNS_MAX_HOPS = 3;
+const long LNS_MAX_VERTICES = 2000;
+
+// each sub-MIP runs on a single thread, with a short time limit
+const double LNS_SUBMIP_TIME_LIMIT = 10.0;
+const int LNS_SUBMIP_THREADS = 1;
+
+// when the largest neighbourhood fails, wait for a new incumbent (at most this
+// many seconds) before trying again with another random neighbourhood
+const double LNS_IDLE_WAIT = 1.0;
+
+const double LNS_EPSILON = 1e-6;
+const unsigned long LNS_SEED = 20231002;
+
+WCMLNS::WCMLNS(IO *instance, GRBEnv *shared_env)
+{
+    /***
+     * If shared_env is given, the sub-MIPs are created within it (NB! it must
+     * not be used by other threads while the lns runs); otherwise, a dedicated
+     * one is started in the lns thread.
+     */
+
+    this->instance = instance;
+    this->shared_env = shared_env;
+
+    this->num_iterations = 0;
+    this->num_improvements = 0;
+    this->lns_runtime = -1;
+
+    this->stop_requested = false;
+    this->current_model = NULL;
+
+    this->incumbent = vector<bool>(instance->graph->num_edges, false);
+    this->incumbent_weight = 0;
+    this->improvement_pending = false;
+    this->hops = 1;
+    this->time_limit = 0;
+}
+
+WCMLNS::~WCMLNS()
+{
+    stop();
+    incumbent.clear();
+}
+
+void WCMLNS::start(const vector<bool> &initial_solution, double time_limit)
+{
+    /// start searching around the given connected matching, in a new thread
+
+    this->incumbent = initial_solution;
+    this->incumbent_weight = instance->graph->edge_subset_weight(incumbent);
+    this->time_limit = time_limit;
+    this->stop_requested = false;
+    this->lns_clock.restart();
+
+    lns_thread = std::thread(&WCMLNS::run, this);
+}
+
+void WCMLNS::stop()
+{
+    /// interrupt the sub-MIP being solved (if any), and wait for the thread
+
+    if (!lns_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(lns_mutex);
+        stop_requested = true;
+
+        // NB! terminate() may be called from another thread
+        if (current_model)
+            current_model->terminate();
+    }
+
+    incumbent_changed.notify_all();
+    lns_thread.join();
+
+    this->lns_runtime = lns_clock.realTime();
+
+    cout << "LNS: " << num_improvements << " improvements in "
+         << num_iterations << " sub-MIPs (" << lns_runtime << " s)" << endl;
+}
+
+void WCMLNS::offer_incumbent(const vector<bool> &solution, double weight)
+{
+    /// new incumbent of the main solver: search around it from now on
+
+    std::lock_guard<std::mutex> lock(lns_mutex);
+
+    if (weight > incumbent_weight + LNS_EPSILON)
+    {
+        incumbent = solution;
+        incumbent_weight = weight;
+        improvement_pending = false;
+        hops = 1;
+
+        incumbent_changed.notify_all();
+    }
+}
+
+bool WCMLNS::take_improvement(vector<bool> &solution, double &weight)
+{
+    /// best solution found by the lns, if the main solver has not seen it yet
+
+    std::lock_guard<std::mutex> lock(lns_mutex);
+
+    if (!improvement_pending)
+        return false;
+
+    solution = incumbent;
+    weight = incumbent_weight;
+    improvement_pending = false;
+
+    return true;
+}
+
+void WCMLNS::run()
+{
+    /// main loop of the lns thread
+
+    // a gurobi environment must not be used by different threads at once
+    vector<GRBEnv*> dedicated_env;
+    if (!shared_env && add_worker_envs(dedicated_env, 1) < 1)
+        return;
+
+    GRBEnv *env = shared_env ? shared_env : dedicated_env[0];
+
+    try
+    {
+        // NB! a shared environment may have been used with other settings
+        env->set(GRB_IntParam_OutputFlag, 0);
+        env->set(GRB_IntParam_Threads, LNS_SUBMIP_THREADS);
+    }
+    catch(GRBException e)
+    {
+        cout << "Environment setup error, code = " << e.getErrorCode() << endl;
+        cout << e.getMessage() << endl;
+        for (GRBEnv *dedicated : dedicated_env)
+            delete dedicated;
+        return;
+    }
+
+    mt19937 rng(LNS_SEED);
+
+    while (!stop_requested && lns_clock.realTime() < time_limit)
+    {
+        // 1. CURRENT INCUMBENT AND NEIGHBOURHOOD SIZE
+        vector<bool> solution;
+        double weight;
+        long current_hops;
+        {
+            std::lock_guard<std::mutex> lock(lns_mutex);
+            solution = incumbent;
+            weight = incumbent_weight;
+            current_hops = hops;
+        }
+
+        vector<long> vertices;
+        neighbourhood(solution, current_hops, rng, vertices);
+
+        // 2. SUB-MIP ON THE NEIGHBOURHOOD
+        bool improved = false;
+        if (vertices.size() > 1)
+            improved = solve_neighbourhood(solution, weight, vertices, env);
+
+        // 3. LARGER NEIGHBOURHOOD IF NOT IMPROVED, OR WAIT FOR A NEW INCUMBENT
+        if (!improved)
+        {
+            std::unique_lock<std::mutex> lock(lns_mutex);
+
+            if (hops < LNS_MAX_HOPS)
+                ++hops;
+            else
+                incumbent_changed.wait_for(lock,
+                    std::chrono::duration<double>(LNS_IDLE_WAIT),
+                    [this, weight]()
+                    { return stop_requested || incumbent_weight > weight; });
+        }
+    }
+
+    for (GRBEnv *dedicated : dedicated_env)
+        delete dedicated;
+}
+
+void WCMLNS::neighbourhood(const vector<bool> &solution,
+                           long max_hops,
+                           mt19937 &rng,
+                           vector<long> &vertices)
+{
+    /***
+     * Vertices covered by the solution and those within max_hops hops of
+     * them, level by level, up to LNS_MAX_VERTICES (covered vertices are
+     * always kept, so that the solution remains feasible in the sub-MIP).
+     */
+
+    Graph *graph = instance->graph;
+
+    vector<bool> reached = vector<bool>(graph->num_vertices, false);
+    vertices.clear();
+
+    for (long e = 0; e < graph->num_edges; ++e)
+    {
+        if (solution[e])
+        {
+            for (long x : {graph->s[e], graph->t[e]})
+            {
+                reached[x] = true;
+                vertices.push_back(x);
+            }
+        }
+    }
+
+    long level_start = 0;
+    for (long hop = 0; hop < max_hops; ++hop)
+    {
+        vector<long> next_level;
+        for (unsigned long i = level_start; i < vertices.size(); ++i)
+        {
+            long u = vertices[i];
+            for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+            {
+                long v = graph->adj_pairs[2*k];
+                if (!reached[v])
+                {
+                    reached[v] = true;
+                    next_level.push_back(v);
+                }
+            }
+        }
+
+        shuffle(next_level.begin(), next_level.end(), rng);
+
+        level_start = vertices.size();
+        for (long v : next_level)
+        {
+            if ((long) vertices.size() >= LNS_MAX_VERTICES)
+                return;
+            vertices.push_back(v);
+        }
+
+        if (next_level.empty())
+            return;
+    }
+}
+
+bool WCMLNS::solve_neighbourhood(const vector<bool> &solution,
+                                 double weight,
+                                 const vector<long> &vertices,
+                                 GRBEnv *env)
+{
+    /***
+     * Solve the sub-MIP on the subgraph induced by the given vertices, warm
+     * started with the solution. Returns true if it found a better one.
+     */
+
+    Graph *graph = instance->graph;
+
+    // NB! a negative time limit is rejected by gurobi
+    double remaining_time = min(LNS_SUBMIP_TIME_LIMIT,
+                                time_limit - lns_clock.realTime());
+    if (remaining_time <= 0)
+        return false;
+
+    vector<long> local_index = vector<long>(graph->num_vertices, -1);
+    for (unsigned long i = 0; i < vertices.size(); ++i)
+        local_index[vertices[i]] = i;
+
+    vector<long> original_edge_index;
+    IO *subinstance = instance->induced_subinstance(vertices,
+                                                    local_index,
+                                                    original_edge_index);
+
+    vector<bool> sub_solution = vector<bool>(original_edge_index.size(), false);
+    for (unsigned long idx = 0; idx < original_edge_index.size(); ++idx)
+        sub_solution[idx] = solution[original_edge_index[idx]];
+
+    WCMModel *model = new WCMModel(subinstance, env);
+    model->set_mip_start(sub_solution);
+    model->set_time_limit(remaining_time);
+
+    // a stop requested after this point (even before the solver starts) is
+    // seen by the callback of the sub-MIP
+    model->set_stop_flag(&stop_requested);
+
+    bool stopped;
+    {
+        std::lock_guard<std::mutex> lock(lns_mutex);
+        current_model = model;
+        stopped = stop_requested;
+    }
+
+    if (!stopped)
+        model->solve(false);
+
+    {
+        std::lock_guard<std::mutex> lock(lns_mutex);
+        current_model = NULL;
+        ++num_iterations;
+    }
+
+    // NB! models keep numeric_limits<double>::max() if nothing was found
+    bool improved = (model->solution_weight < numeric_limits<double>::max() &&
+                     model->solution_weight > weight + LNS_EPSILON);
+
+    if (improved)
+    {
+        vector<bool> lifted = vector<bool>(graph->num_edges, false);
+        for (unsigned long idx = 0; idx < original_edge_index.size(); ++idx)
+            if (model->solution_vector_x[idx])
+                lifted[original_edge_index[idx]] = true;
+
+        std::lock_guard<std::mutex> lock(lns_mutex);
+
+        // NB! the main solver may have found something better meanwhile
+        if (model->solution_weight > incumbent_weight + LNS_EPSILON)
+        {
+            incumbent = lifted;
+            incumbent_weight = model->solution_weight;
+            improvement_pending = true;
+            hops = 1;
+            ++num_improvements;
+        }
+        else
+            improved = false;
+    }
+
+    delete model;
+    delete subinstance;
+
+    return improved;
+}
+
+void WCMLNS::save_json_info(IO *record)
+{
+    /// save lns info in the json record
+
+    record->save_json_field("lns_iterations", num_iterations);
+    record->save_json_field("lns_improvements", num_improvements);
+    record->save_json_field("lns_runtime", lns_runtime);
+}
@@ -0,0 +1,79 @@
+#ifndef _WCM_LNS_H_
+#define _WCM_LNS_H_
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "gurobi_c++.h"
+
+#include "io.h"
+#include "wcm_model.h"
+
+/***
+ * \file wcm_lns.h
+ *
+ * Module for a large neighbourhood search running alongside the main solver,
+ * in a separate thread with its own Gurobi environment. Each step solves a
+ * small integer program (separators-based formulation, with its own cut
+ * generator) on the subgraph induced by the vertices within a few hops of
+ * those covered by the incumbent, i.e. with edges farther away fixed to zero.
+ * Incumbents and improvements are exchanged with the main solver through the
+ * callback (see WCMCutGenerator). The environment may be given (e.g. by a
+ * batch run, which then keeps it for all instances) instead of being started
+ * in each run.
+ *
+ * \author Phillippe Samer <samer@uib.no>
+ * \date 17.10.2026
+ */
+
+class WCMLNS
+{
+public:
+    WCMLNS(IO*, GRBEnv* = NULL);
+    virtual ~WCMLNS();
+
+    void start(const vector<bool> &, double);
+    void stop();
+
+    // exchange of solutions with the main solver (thread-safe)
+    void offer_incumbent(const vector<bool> &, double);
+    bool take_improvement(vector<bool> &, double &);
+
+    long num_iterations;
+    long num_improvements;
+    double lns_runtime;
+
+    void save_json_info(IO*);
+
+protected:
+    IO *instance;
+    GRBEnv *shared_env;     // not deleted with this object (if given)
+
+    std::thread lns_thread;
+    std::mutex lns_mutex;
+    std::condition_variable incumbent_changed;
+    std::atomic<bool> stop_requested;
+    WCMModel *current_model;        // being solved (so that it may be stopped)
+
+    // best solution known, and whether the main solver has not taken it yet
+    vector<bool> incumbent;
+    double incumbent_weight;
+    bool improvement_pending;
+    long hops;
+
+    double time_limit;
+    Timer lns_clock;
+
+    void run();
+    void neighbourhood(const vector<bool> &, long, mt19937 &, vector<long> &);
+    bool solve_neighbourhood(const vector<bool> &, double,
+                             const vector<long> &, GRBEnv *);
+};
+
+#endif
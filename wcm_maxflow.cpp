@@ -0,0 +1,325 @@
+#include "wcm_maxflow.h"
+
+// residual capacities and excesses below this value are taken as zero
+const double MAX_FLOW_EPSILON = 1e-10;
+
+// labels are recomputed exactly after this many relabels, per node
+const double MAX_FLOW_GLOBAL_RELABEL_FREQUENCY = 1.0;
+
+WCMFlowNetwork::WCMFlowNetwork()
+{
+    this->num_nodes = 0;
+    this->num_arcs = 0;
+}
+
+WCMFlowNetwork::~WCMFlowNetwork()
+{
+    clear();
+}
+
+void WCMFlowNetwork::clear()
+{
+    /// remove all arcs (keeping the allocated memory)
+
+    arc_tail.clear();
+    arc_head.clear();
+    arc_capacity.clear();
+    num_nodes = 0;
+    num_arcs = 0;
+}
+
+void WCMFlowNetwork::add_arc(long tail, long head, double capacity)
+{
+    arc_tail.push_back(tail);
+    arc_head.push_back(head);
+    arc_capacity.push_back(capacity);
+}
+
+void WCMFlowNetwork::build(long num_nodes)
+{
+    /// arrange the arcs added (nodes 0, ..., num_nodes-1) in CSR format
+
+    this->num_nodes = num_nodes;
+
+    const long m = arc_tail.size();
+    this->num_arcs = 2 * m;
+
+    // each arc also gives a reverse arc out of its head
+    offset.assign(num_nodes + 1, 0);
+    for (long a = 0; a < m; ++a)
+    {
+        ++offset[arc_tail[a] + 1];
+        ++offset[arc_head[a] + 1];
+    }
+
+    for (long u = 0; u < num_nodes; ++u)
+        offset[u+1] += offset[u];
+
+    head.resize(num_arcs);
+    capacity.resize(num_arcs);
+    reverse.resize(num_arcs);
+
+    vector<long> fill = vector<long>(offset.begin(), offset.end() - 1);
+    for (long a = 0; a < m; ++a)
+    {
+        long forward = fill[arc_tail[a]]++;
+        long backward = fill[arc_head[a]]++;
+
+        head[forward] = arc_head[a];
+        capacity[forward] = arc_capacity[a];
+        reverse[forward] = backward;
+
+        head[backward] = arc_tail[a];
+        capacity[backward] = 0;
+        reverse[backward] = forward;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+WCMMaxFlow::WCMMaxFlow(const WCMFlowNetwork &network) : network(network)
+{
+    this->num_nodes = 0;
+    this->source = -1;
+    this->target = -1;
+    this->stopped_at_cutoff = false;
+}
+
+WCMMaxFlow::~WCMMaxFlow()
+{
+    residual.clear();
+    excess.clear();
+    label.clear();
+}
+
+double WCMMaxFlow::run(long s, long t, double cutoff)
+{
+    /***
+     * Compute a maximum preflow from s to t, and return its value, i.e. the
+     * capacity of a minimum (s,t)-cut. Stops as soon as the flow into t
+     * reaches the cutoff value (see reached_cutoff), returning the flow so far.
+     */
+
+    this->num_nodes = network.num_nodes;
+    this->source = s;
+    this->target = t;
+    this->stopped_at_cutoff = false;
+
+    residual = network.capacity;
+    excess.assign(num_nodes, 0);
+    label.assign(num_nodes, 0);
+    label_count.assign(num_nodes + 1, 0);
+    current_arc.assign(network.offset.begin(), network.offset.end() - 1);
+    in_queue.assign(num_nodes, false);
+    active.clear();
+
+    global_relabel();
+
+    // saturate every arc out of the source
+    for (long a = network.offset[s]; a < network.offset[s+1]; ++a)
+    {
+        const double delta = residual[a];
+        if (delta > MAX_FLOW_EPSILON)
+        {
+            const long v = network.head[a];
+            residual[a] = 0;
+            residual[network.reverse[a]] += delta;
+            excess[v] += delta;
+
+            if (v != t && label[v] < num_nodes && !in_queue[v])
+            {
+                active.push_back(v);
+                in_queue[v] = true;
+            }
+        }
+    }
+
+    if (excess[t] >= cutoff)
+    {
+        stopped_at_cutoff = true;
+        return excess[t];
+    }
+
+    const long global_relabel_interval =
+        max(1L, (long) (MAX_FLOW_GLOBAL_RELABEL_FREQUENCY * num_nodes));
+    long relabels = 0;
+
+    // FIFO queue, advancing through active (and compacting it at times)
+    long head_of_queue = 0;
+    while (head_of_queue < (long) active.size())
+    {
+        const long u = active[head_of_queue++];
+        in_queue[u] = false;
+
+        // discharge u (nodes labelled n or more cannot reach the target)
+        while (excess[u] > MAX_FLOW_EPSILON && label[u] < num_nodes)
+        {
+            const long end = network.offset[u+1];
+            long &a = current_arc[u];
+
+            while (a < end && excess[u] > MAX_FLOW_EPSILON)
+            {
+                const long v = network.head[a];
+                if (residual[a] > MAX_FLOW_EPSILON && label[u] == label[v] + 1)
+                {
+                    const double delta = min(excess[u], residual[a]);
+                    residual[a] -= delta;
+                    residual[network.reverse[a]] += delta;
+                    excess[u] -= delta;
+                    excess[v] += delta;
+
+                    if (v != t && v != s && !in_queue[v])
+                    {
+                        active.push_back(v);
+                        in_queue[v] = true;
+                    }
+                }
+                else
+                    ++a;
+            }
+
+            if (excess[t] >= cutoff)
+            {
+                stopped_at_cutoff = true;
+                return excess[t];
+            }
+
+            if (excess[u] > MAX_FLOW_EPSILON)
+            {
+                relabel(u);
+
+                if (++relabels >= global_relabel_interval)
+                {
+                    relabels = 0;
+                    global_relabel();
+                }
+            }
+        }
+
+        if (head_of_queue > num_nodes && 2 * head_of_queue > (long) active.size())
+        {
+            active.erase(active.begin(), active.begin() + head_of_queue);
+            head_of_queue = 0;
+        }
+    }
+
+    mark_target_side();
+    return excess[t];
+}
+
+bool WCMMaxFlow::reached_cutoff()
+{
+    /// whether the last run stopped early (then the min cut is not available)
+
+    return stopped_at_cutoff;
+}
+
+bool WCMMaxFlow::source_side(long u)
+{
+    /// whether u is on the source side of the min cut found by the last run
+
+    return !reaches_target[u];
+}
+
+void WCMMaxFlow::global_relabel()
+{
+    /***
+     * Exact distance labels: backwards bfs from the target in the residual
+     * network. Nodes that cannot reach the target get label n (and so do the
+     * source and the nodes of its side).
+     */
+
+    label.assign(num_nodes, num_nodes);
+    label_count.assign(num_nodes + 1, 0);
+
+    bfs_queue.clear();
+    bfs_queue.push_back(target);
+    label[target] = 0;
+
+    for (unsigned long i = 0; i < bfs_queue.size(); ++i)
+    {
+        const long v = bfs_queue[i];
+
+        for (long a = network.offset[v]; a < network.offset[v+1]; ++a)
+        {
+            const long u = network.head[a];
+
+            // the arc (u,v) is the reverse of (v,u)
+            if (label[u] == num_nodes && u != source &&
+                residual[network.reverse[a]] > MAX_FLOW_EPSILON)
+            {
+                label[u] = label[v] + 1;
+                bfs_queue.push_back(u);
+            }
+        }
+    }
+
+    for (long u = 0; u < num_nodes; ++u)
+    {
+        ++label_count[label[u]];
+        current_arc[u] = network.offset[u];
+    }
+}
+
+void WCMMaxFlow::relabel(long u)
+{
+    /// smallest label allowing some push out of u (n if none), with gap check
+
+    const long old_label = label[u];
+    long new_label = num_nodes;
+
+    for (long a = network.offset[u]; a < network.offset[u+1]; ++a)
+        if (residual[a] > MAX_FLOW_EPSILON)
+            new_label = min(new_label, label[network.head[a]] + 1);
+
+    if (new_label > num_nodes)
+        new_label = num_nodes;
+
+    --label_count[old_label];
+    label[u] = new_label;
+    ++label_count[new_label];
+    current_arc[u] = network.offset[u];
+
+    // no node left with the old label: those above it cannot reach the target
+    if (label_count[old_label] == 0 && old_label < num_nodes)
+        gap(old_label);
+}
+
+void WCMMaxFlow::gap(long k)
+{
+    for (long u = 0; u < num_nodes; ++u)
+    {
+        if (label[u] > k && label[u] < num_nodes)
+        {
+            --label_count[label[u]];
+            label[u] = num_nodes;
+            ++label_count[num_nodes];
+        }
+    }
+}
+
+void WCMMaxFlow::mark_target_side()
+{
+    /// nodes that can still reach the target in the residual network
+
+    reaches_target.assign(num_nodes, false);
+    reaches_target[target] = true;
+
+    bfs_queue.clear();
+    bfs_queue.push_back(target);
+
+    for (unsigned long i = 0; i < bfs_queue.size(); ++i)
+    {
+        const long v = bfs_queue[i];
+
+        for (long a = network.offset[v]; a < network.offset[v+1]; ++a)
+        {
+            const long u = network.head[a];
+            if (!reaches_target[u] && residual[network.reverse[a]] > MAX_FLOW_EPSILON)
+            {
+                reaches_target[u] = true;
+                bfs_queue.push_back(u);
+            }
+        }
+    }
+}
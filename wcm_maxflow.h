@@ -0,0 +1,91 @@
+#ifndef _WCM_MAX_FLOW_H_
+#define _WCM_MAX_FLOW_H_
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+/***
+ * \file wcm_maxflow.h
+ *
+ * Module for a push-relabel max flow kernel on a flat CSR arc array, used to
+ * separate MSI from fractional points. The auxiliary network of that
+ * separation has the n split-vertex arcs (u_1,u_2) with capacity y_u, and
+ * "unlimited" arcs (capacity n+1) from the edges of the instance graph, so a
+ * generic graph representation buys nothing.
+ *
+ * WCMFlowNetwork holds the arcs (and their reverse arcs) of the network, and
+ * may be shared by several threads, each running its own WCMMaxFlow on it.
+ * The latter computes a maximum preflow (FIFO selection, with global
+ * relabeling and the gap heuristic), like the first phase of lemon::Preflow,
+ * and stops early as soon as the flow reaches a given cutoff value.
+ *
+ * \author Phillippe Samer <samer@uib.no>
+ * \date 17.10.2026
+ */
+
+class WCMFlowNetwork
+{
+public:
+    WCMFlowNetwork();
+    virtual ~WCMFlowNetwork();
+
+    void clear();
+    void add_arc(long, long, double);
+    void build(long);
+
+    long num_nodes;
+    long num_arcs;            // including reverse arcs
+
+protected:
+    friend class WCMMaxFlow;
+
+    // arcs as added, before build()
+    vector<long> arc_tail;
+    vector<long> arc_head;
+    vector<double> arc_capacity;
+
+    // CSR: arcs out of node u are [offset[u], offset[u+1]), each one with its
+    // head, capacity (0 for reverse arcs) and the position of its reverse arc
+    vector<long> offset;
+    vector<long> head;
+    vector<double> capacity;
+    vector<long> reverse;
+};
+
+class WCMMaxFlow
+{
+public:
+    WCMMaxFlow(const WCMFlowNetwork &);
+    virtual ~WCMMaxFlow();
+
+    double run(long, long, double);
+    bool reached_cutoff();
+    bool source_side(long);
+
+protected:
+    const WCMFlowNetwork &network;
+    long num_nodes;
+    long source;
+    long target;
+    bool stopped_at_cutoff;
+
+    vector<double> residual;
+    vector<double> excess;
+    vector<long> label;
+    vector<long> label_count;
+    vector<long> current_arc;
+    vector<long> active;          // FIFO queue of active nodes
+    vector<bool> in_queue;
+    vector<long> bfs_queue;
+    vector<bool> reaches_target;  // in the residual network, after run()
+
+    void global_relabel();
+    void relabel(long);
+    void gap(long);
+    void mark_target_side();
+};
+
+#endif
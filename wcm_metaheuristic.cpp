@@ -0,0 +1,205 @@
+#include "wcm_metaheuristic.h"
+
+// iterated local search parameters
+const long ILS_PERTURBATION_STRENGTH = 3;      // edges dropped/added per kick
+const long ILS_RESTART_AFTER = 200;            // non-improving iterations
+
+// every so many restarts start from the best solution of all threads (kicked
+// harder), instead of a random one
+const long ILS_RESTART_FROM_BEST_EVERY = 2;
+const long ILS_RESTART_PERTURBATION_STRENGTH = 10;
+const unsigned long ILS_BASE_SEED = 20231002;  // thread i uses seed + i
+const double ILS_EPSILON = 1e-9;
+
+WCMMetaheuristic::WCMMetaheuristic(IO *instance)
+{
+    this->instance = instance;
+
+    // empty matching is always feasible
+    this->solution_weight = 0;
+    this->solution_vector_x = vector<bool>(instance->graph->num_edges, false);
+    this->solution_runtime = -1;
+    this->solution_time_found = 0;
+    this->num_iterations = 0;
+    this->num_threads = 0;
+
+    this->best_weight = 0;
+    this->next_iteration = 0;
+    this->time_limit = 0;
+    this->max_iterations = 0;
+}
+
+WCMMetaheuristic::~WCMMetaheuristic()
+{
+    solution_vector_x.clear();
+}
+
+void WCMMetaheuristic::set_incumbent(const vector<bool> &edge_in_solution)
+{
+    /// use a known connected matching (e.g. a MIP start) if it is better
+
+    double weight = instance->graph->edge_subset_weight(edge_in_solution);
+
+    if (weight > solution_weight)
+    {
+        solution_weight = weight;
+        solution_vector_x = edge_in_solution;
+        best_weight = weight;
+    }
+}
+
+int WCMMetaheuristic::solve(double time_limit,
+                            long max_iterations,
+                            long num_threads)
+{
+    /***
+     * Run num_threads searches (0 for one per hardware thread), sharing the
+     * best solution, until time_limit seconds have passed, or max_iterations
+     * iterations were run overall (0 for no limit). Returns the number of
+     * iterations.
+     */
+
+    this->time_limit = time_limit;
+    this->max_iterations = max_iterations;
+    this->next_iteration = 0;
+    this->solve_clock.restart();
+
+    if (num_threads < 1)
+        num_threads = std::thread::hardware_concurrency();
+    if (num_threads < 1)
+        num_threads = 1;
+
+    this->num_threads = num_threads;
+
+    cout << "Iterated local search: " << num_threads << " threads, "
+         << time_limit << " s";
+    if (max_iterations > 0)
+        cout << " or " << max_iterations << " iterations";
+    cout << endl;
+
+    vector<std::thread> workers;
+    for (long i = 0; i < num_threads; ++i)
+        workers.push_back(std::thread(&WCMMetaheuristic::worker, this, i));
+
+    for (std::thread &t : workers)
+        t.join();
+
+    this->solution_runtime = solve_clock.realTime();
+    this->num_iterations = next_iteration;
+    if (max_iterations > 0)
+        this->num_iterations = min(num_iterations, max_iterations);
+
+    cout << "Iterated local search: best weight " << solution_weight
+         << " (found at " << solution_time_found << " s), "
+         << num_iterations << " iterations in " << solution_runtime << " s"
+         << endl;
+
+    // same check as for the solutions of the integer programs
+    if (!instance->graph->is_connected_matching(solution_vector_x, true))
+        cout << endl
+             << "######################" << endl
+             << "### WRONG SOLUTION ###" << endl
+             << "######################" << endl << endl;
+
+    return num_iterations;
+}
+
+void WCMMetaheuristic::worker(long thread_id)
+{
+    /// iterated local search with random restarts, in a single thread
+
+    WCMHeuristic *heuristic = new WCMHeuristic(instance);
+    mt19937 rng(ILS_BASE_SEED + thread_id);
+
+    vector<bool> current, candidate;
+    double current_weight = heuristic->random_restart(current, rng);
+    update_incumbent(current, current_weight);
+
+    long stalled = 0;
+    long restarts = 0;
+
+    while (solve_clock.realTime() < time_limit)
+    {
+        long iteration = next_iteration++;
+        if (max_iterations > 0 && iteration >= max_iterations)
+            break;
+
+        // 1. KICK AND LOCAL SEARCH
+        candidate = current;
+        heuristic->perturb(candidate, rng, ILS_PERTURBATION_STRENGTH);
+        double weight = heuristic->local_search(candidate);
+
+        // 2. ACCEPT IF NOT WORSE (TO DRIFT ACROSS PLATEAUS)
+        if (weight > current_weight + ILS_EPSILON)
+            stalled = 0;
+        else
+            ++stalled;
+
+        if (weight >= current_weight - ILS_EPSILON)
+        {
+            current.swap(candidate);
+            current_weight = weight;
+            update_incumbent(current, current_weight);
+        }
+
+        // 3. RESTART WHEN STUCK: AT RANDOM, OR AROUND THE BEST SOLUTION SO FAR
+        if (stalled >= ILS_RESTART_AFTER)
+        {
+            ++restarts;
+            if (restarts % ILS_RESTART_FROM_BEST_EVERY == 0 &&
+                copy_incumbent(current) > 0)
+            {
+                heuristic->perturb(current, rng, ILS_RESTART_PERTURBATION_STRENGTH);
+                current_weight = heuristic->local_search(current);
+            }
+            else
+                current_weight = heuristic->random_restart(current, rng);
+
+            update_incumbent(current, current_weight);
+            stalled = 0;
+        }
+    }
+
+    delete heuristic;
+}
+
+void WCMMetaheuristic::update_incumbent(const vector<bool> &edge_in_solution,
+                                        double weight)
+{
+    /// share a solution with other threads, if it improves the best one
+
+    // NB! checking without the lock first, as most solutions do not improve
+    if (weight <= best_weight + ILS_EPSILON)
+        return;
+
+    std::lock_guard<std::mutex> lock(incumbent_mutex);
+
+    if (weight > solution_weight + ILS_EPSILON)
+    {
+        solution_weight = weight;
+        solution_vector_x = edge_in_solution;
+        solution_time_found = solve_clock.realTime();
+        best_weight = weight;
+    }
+}
+
+double WCMMetaheuristic::copy_incumbent(vector<bool> &edge_in_solution)
+{
+    /// copy of the best solution of all threads so far, returning its weight
+
+    std::lock_guard<std::mutex> lock(incumbent_mutex);
+
+    edge_in_solution = solution_vector_x;
+    return solution_weight;
+}
+
+void WCMMetaheuristic::save_json_info(IO *record)
+{
+    /// save search info in the json record
+
+    record->save_json_field("ils_weight", solution_weight);
+    record->save_json_field("ils_time_found", solution_time_found);
+    record->save_json_field("ils_iterations", num_iterations);
+    record->save_json_field("ils_threads", num_threads);
+    record->save_json_field("ils_runtime", solution_runtime);
+}
@@ -0,0 +1,63 @@
+#ifndef _WCM_METAHEURISTIC_H_
+#define _WCM_METAHEURISTIC_H_
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "io.h"
+#include "wcm_heuristic.h"
+
+/***
+ * \file wcm_metaheuristic.h
+ *
+ * Module for a standalone, multi-threaded iterated local search over connected
+ * matchings, for instances too large for the integer programs. Each thread
+ * runs its own search (with its own WCMHeuristic and random seed), and the
+ * best solution is shared among them: every other restart of a thread starts
+ * from a strong perturbation of the best solution found by any thread. The
+ * search stops on a time limit or on a total number of iterations, and gives
+ * no dual bound.
+ *
+ * \author Phillippe Samer <samer@uib.no>
+ * \date 17.10.2026
+ */
+
+class WCMMetaheuristic
+{
+public:
+    WCMMetaheuristic(IO*);
+    virtual ~WCMMetaheuristic();
+
+    void set_incumbent(const vector<bool> &);
+    int solve(double, long, long);
+
+    double solution_weight;
+    vector<bool> solution_vector_x;   // edge in matching or not
+    double solution_runtime;
+    double solution_time_found;       // when the best solution was found
+    long num_iterations;
+    long num_threads;
+
+    void save_json_info(IO*);
+
+protected:
+    IO *instance;
+
+    // shared state among worker threads
+    std::mutex incumbent_mutex;
+    std::atomic<double> best_weight;
+    std::atomic<long> next_iteration;
+    double time_limit;
+    long max_iterations;
+    Timer solve_clock;
+
+    void worker(long);
+    void update_incumbent(const vector<bool> &, double);
+    double copy_incumbent(vector<bool> &);
+};
+
+#endif
@@ -10,8 +10,14 @@ const bool GRB_HEURISTICS_FOCUS = true; // extra focus on gurobi heuristics
 
 const double EPSILON_TOL = 1e-5;
 
-WCMModel::WCMModel(IO *instance)
+WCMModel::WCMModel(IO *instance, GRBEnv *shared_env)
 {
+    /***
+     * If shared_env is given (e.g. when solving many instances in the same
+     * process), the model is created within it and the environment is NOT
+     * deleted with this object; otherwise, a dedicated one is created.
+     */
+
     this->instance = instance;
 
     this->solution_weight = numeric_limits<double>::max();
@@ -20,12 +26,15 @@ WCMModel::WCMModel(IO *instance)
     this->solution_vector_y = vector<bool>(instance->graph->num_vertices, false);
     this->solution_status = STATUS_UNKNOWN;
     this->solution_runtime = -1;
+    this->objective_upper_bound = numeric_limits<double>::max();
 
     this->lp_bound = this->lp_runtime = this->lp_passes = -1;
 
+    this->owns_env = (shared_env == NULL);
+
     try
     {
-        this->env = new GRBEnv();
+        this->env = owns_env ? new GRBEnv() : shared_env;
         this->model = new GRBModel(*env);
 
         create_variables();
@@ -43,6 +52,38 @@ WCMModel::WCMModel(IO *instance)
     }
 }
 
+long add_worker_envs(vector<GRBEnv*> &envs, long count)
+{
+    /***
+     * Start quiet environments until there are (at least) count of them in
+     * envs, for threads solving models at the same time: a gurobi environment
+     * must not be used by different threads at once. Returns how many are
+     * available (fewer than count if an environment could not be started).
+     */
+
+    while ((long) envs.size() < count)
+    {
+        GRBEnv *env = NULL;
+        try
+        {
+            env = new GRBEnv(true);
+            env->set(GRB_IntParam_OutputFlag, 0);
+            env->start();
+        }
+        catch(GRBException e)
+        {
+            cout << "Environment creation error, code = " << e.getErrorCode() << endl;
+            cout << e.getMessage() << endl;
+            delete env;
+            break;
+        }
+
+        envs.push_back(env);
+    }
+
+    return envs.size();
+}
+
 WCMModel::~WCMModel()
 {
     delete cutgen;
@@ -50,7 +91,9 @@ WCMModel::~WCMModel()
     delete[] x;
     delete[] y;
     delete model;
-    delete env;
+
+    if (owns_env)
+        delete env;
 }
 
 void WCMModel::create_variables()
@@ -86,11 +129,10 @@ void WCMModel::create_constraints()
     {
         GRBLinExpr deg_ineq = 0;
 
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
             deg_ineq += x[e];
         }
 
@@ -104,11 +146,10 @@ void WCMModel::create_constraints()
     {
         GRBLinExpr link_xy = 0;
 
-        for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-             it != instance->graph->adj_list.at(u).end(); ++it)
+        for (long k = instance->graph->adj_offset[u];
+             k < instance->graph->adj_offset[u+1]; ++k)
         {
-            long v = *it;
-            long e = instance->graph->index_matrix[u][v];
+            long e = instance->graph->adj_pairs[2*k + 1];
             link_xy += x[e];
         }
 
@@ -190,6 +231,14 @@ int WCMModel::solve(bool logging)
 
             cout << "Indegree inequalities added: "
                  << cutgen->indegree_counter << endl;
+
+            cout << "LP rounding heuristic: " << cutgen->rounding_improvements
+                 << " improved incumbents in " << cutgen->rounding_calls
+                 << " calls" << endl;
+
+            cout << "Repair heuristic: " << cutgen->repair_improvements
+                 << " improved incumbents in " << cutgen->repair_calls
+                 << " calls" << endl;
         }
 
         return this->save_optimization_status();
@@ -226,11 +275,10 @@ bool WCMModel::check_solution()
         {
             bool chosen_vertex_indeed_covered = false;
 
-            for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-                 it != instance->graph->adj_list.at(u).end(); ++it)
+            for (long k = instance->graph->adj_offset[u];
+                 k < instance->graph->adj_offset[u+1]; ++k)
             {
-                long v = *it;
-                long edge_idx = instance->graph->index_matrix[u][v];
+                long edge_idx = instance->graph->adj_pairs[2*k + 1];
                 if (solution_vector_x.at(edge_idx))
                     chosen_vertex_indeed_covered = true;
             }
@@ -245,11 +293,11 @@ bool WCMModel::check_solution()
         {
             bool missing_vertex_indeed_not_covered = true;
 
-            for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-                 it != instance->graph->adj_list.at(u).end(); ++it)
+            for (long k = instance->graph->adj_offset[u];
+                 k < instance->graph->adj_offset[u+1]; ++k)
             {
-                long v = *it;
-                long edge_idx = instance->graph->index_matrix[u][v];
+                long v = instance->graph->adj_pairs[2*k];
+                long edge_idx = instance->graph->adj_pairs[2*k + 1];
                 if (solution_vector_x.at(edge_idx))
                 {
                     missing_vertex_indeed_not_covered = false;
@@ -272,73 +320,10 @@ bool WCMModel::check_solution()
         }
     }
 
-    // II. X VARS INDUCE A MATCHING
-
-    vector<long> degree_in_solution = vector<long>(instance->graph->num_vertices, 0);
-    bool still_a_matching = true;
+    // II. X VARS INDUCE A MATCHING, AND III. Y VARS INDUCE A CONNECTED
+    // SUBGRAPH (after part I, y is exactly the set of vertices covered by x)
 
-    for (long e = 0; e < instance->graph->num_edges; ++e)
-    {
-        if (solution_vector_x.at(e))
-        {
-            long v1 = instance->graph->s.at(e);
-            long v2 = instance->graph->t.at(e);
-            degree_in_solution.at(v1)++;
-            degree_in_solution.at(v2)++;
-
-            if (degree_in_solution.at(v1) > 1 || degree_in_solution.at(v2) > 1)
-                still_a_matching = false;
-        }
-    }
-
-    if (!still_a_matching)
-    {
-        cout << endl << "ERROR (MATCHING): some vertex has degree above 1" << endl;
-        return false;
-    }
-
-
-    // III. Y VARS INDUCE A CONNECTED SUBGRAPH
-
-    long num_components = 0;
-    vector<bool> seen = vector<bool>(instance->graph->num_vertices, false);
-
-    for (long u = 0; u < instance->graph->num_vertices; ++u)
-    {
-        // should enter only once, from the first covered vertex 
-        if (solution_vector_y.at(u) && !seen.at(u))
-        {
-            dfs_to_tag_component(u, seen);
-            ++num_components;
-        }
-    }
-
-    if (num_components > 1)
-    {
-        cout << endl
-             << "ERROR (CONNECTIVITY): subgraph induced by y is not connected ("
-             << num_components << " components)" << endl;
-        return false;
-    }
-
-    return true;
-}
-
-void WCMModel::dfs_to_tag_component(long u,
-                                    vector<bool> &seen)
-{
-    // auxiliary dfs to check the connected component from vertex u
-
-    seen.at(u) = true;
-
-    for (list<long>::iterator it = instance->graph->adj_list.at(u).begin();
-         it != instance->graph->adj_list.at(u).end(); ++it)
-    {
-        long v = *it;
-
-        if (solution_vector_y.at(v) && !seen.at(v))
-            dfs_to_tag_component(v, seen);
-    }
+    return instance->graph->is_connected_matching(solution_vector_x, true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -349,7 +334,10 @@ int WCMModel::save_optimization_status()
 
     this->solution_runtime = model->get(GRB_DoubleAttr_Runtime);
 
-    if (model->get(GRB_IntAttr_Status) == GRB_OPTIMAL)
+    // NB! BestObjStop is only set to a valid upper bound (see
+    // set_objective_upper_bound), so reaching it means optimality
+    if (model->get(GRB_IntAttr_Status) == GRB_OPTIMAL ||
+        model->get(GRB_IntAttr_Status) == GRB_USER_OBJ_LIMIT)
     {
         this->solution_status = AT_OPTIMUM;
 
@@ -387,7 +375,8 @@ int WCMModel::save_optimization_status()
     {
         this->solution_status = STATUS_UNKNOWN;
 
-        this->solution_dualbound = model->get(GRB_DoubleAttr_ObjBound);
+        this->solution_dualbound = min(model->get(GRB_DoubleAttr_ObjBound),
+                                       objective_upper_bound);
 
         if (model->get(GRB_IntAttr_SolCount) > 0)
         {
@@ -587,6 +576,32 @@ bool WCMModel::solve_lp_relax(bool logging, double time_limit, bool grb_cuts_off
             cout << "[LPR] Indegree inequalities added: "
                  << cutgen->indegree_counter << endl << endl;
 
+            BlossomBenchmark &benchmark = cutgen->blossom_benchmark;
+            if (benchmark.points > 0)
+            {
+                cout << "[LPR] Exact BI separation on " << benchmark.points
+                     << " points: Padberg-Rao found "
+                     << benchmark.padberg_rao_found << " in "
+                     << benchmark.padberg_rao_time << "s, fractional support found "
+                     << benchmark.fractional_found << " in "
+                     << benchmark.fractional_time << "s ("
+                     << benchmark.disagreements << " disagreements)"
+                     << endl << endl;
+            }
+
+            MaxFlowBenchmark flow_benchmark = cutgen->get_max_flow_benchmark();
+            if (flow_benchmark.pairs > 0)
+            {
+                cout << "[LPR] MSI max flows on " << flow_benchmark.pairs
+                     << " pairs: LEMON found " << flow_benchmark.lemon_violated
+                     << " cuts in " << flow_benchmark.lemon_time
+                     << "s, CSR found " << flow_benchmark.csr_violated
+                     << " in " << flow_benchmark.csr_time << "s ("
+                     << flow_benchmark.csr_early_exits << " early exits, "
+                     << flow_benchmark.disagreements << " disagreements)"
+                     << endl << endl;
+            }
+
             long x_frac = 0;
             for (long e = 0; e < instance->graph->num_edges; ++e)
             {
@@ -652,6 +667,77 @@ bool WCMModel::solve_lp_relax(bool logging, double time_limit, bool grb_cuts_off
     }
 }
 
+bool WCMModel::set_mip_start(const vector<bool> &edge_in_solution)
+{
+    /***
+     * Provide a (connected matching) solution as a MIP start: x from the given
+     * edge subset, and y from the vertices it covers.
+     */
+
+    try
+    {
+        vector<bool> covered = vector<bool>(instance->graph->num_vertices, false);
+
+        for (long e = 0; e < instance->graph->num_edges; ++e)
+        {
+            x[e].set(GRB_DoubleAttr_Start, edge_in_solution[e] ? 1.0 : 0.0);
+
+            if (edge_in_solution[e])
+            {
+                covered[instance->graph->s[e]] = true;
+                covered[instance->graph->t[e]] = true;
+            }
+        }
+
+        for (long u = 0; u < instance->graph->num_vertices; ++u)
+            y[u].set(GRB_DoubleAttr_Start, covered[u] ? 1.0 : 0.0);
+
+        model->update();
+        return true;
+    }
+    catch(GRBException e)
+    {
+        cout << "Error setting MIP start, code = " << e.getErrorCode() << endl;
+        cout << e.getMessage() << endl;
+        return false;
+    }
+}
+
+void WCMModel::set_objective_upper_bound(double bound)
+{
+    /***
+     * Let gurobi stop as soon as it finds a solution matching a known upper
+     * bound on the optimum (e.g. the weight of a maximum weight matching).
+     */
+
+    this->objective_upper_bound = bound;
+    model->set(GRB_DoubleParam_BestObjStop, bound);
+}
+
+void WCMModel::set_lns(WCMLNS *lns)
+{
+    /// exchange incumbents with a large neighbourhood search, via callback
+
+    cutgen->lns = lns;
+}
+
+void WCMModel::set_stop_flag(const std::atomic<bool> *flag)
+{
+    /***
+     * Abort optimization from the callback once the flag is set: unlike
+     * terminate(), this also works if the flag is set before solve() begins.
+     */
+
+    cutgen->stop_flag = flag;
+}
+
+void WCMModel::terminate()
+{
+    /// stop optimization (as soon as possible), e.g. from another thread
+
+    model->terminate();
+}
+
 void WCMModel::set_time_limit(double tl)
 {
     model->set(GRB_DoubleParam_TimeLimit, tl);
@@ -664,6 +750,9 @@ double WCMModel::get_mip_runtime()
 
 double WCMModel::get_mip_gap()
 {
+    if (model->get(GRB_IntAttr_Status) == GRB_USER_OBJ_LIMIT)
+        return 0;
+
     return model->get(GRB_DoubleAttr_MIPGap);
 }
 
@@ -686,3 +775,80 @@ long WCMModel::get_mip_msi_counter()
 {
     return cutgen->minimal_separators_counter;
 }
+
+void inline save_json_separation_stats(IO *instance,
+                                       string family,
+                                       SeparationStats &stats)
+{
+    instance->save_json_field(family + "_rounds", stats.rounds);
+    instance->save_json_field(family + "_found", stats.found);
+    instance->save_json_field(family + "_added_user_cuts", stats.added_as_user_cuts);
+    instance->save_json_field(family + "_added_lazy", stats.added_as_lazy);
+    instance->save_json_field(family + "_added_lp", stats.added_to_lp);
+    instance->save_json_field(family + "_wall_time", stats.wall_time);
+    instance->save_json_field(family + "_cpu_time", stats.cpu_time);
+}
+
+void WCMModel::save_json_info(IO *record)
+{
+    /// save lp relaxation, mip and separation info in the given json record
+
+    record->save_json_field("formulation", string("separators"));
+
+    record->save_json_field("lp_bound", lp_bound);
+    record->save_json_field("lp_runtime", lp_runtime);
+    record->save_json_field("lp_passes", lp_passes);
+
+    record->save_json_field("status", string(solution_status == AT_OPTIMUM ?
+                                               "OPTIMAL" : "UNKNOWN"));
+    record->save_json_field("mip_primal_bound", solution_weight);
+    record->save_json_field("mip_dual_bound", solution_dualbound);
+    record->save_json_field("mip_gap", get_mip_gap());
+    record->save_json_field("mip_nodes", get_mip_num_nodes());
+    record->save_json_field("mip_runtime", get_mip_runtime());
+
+    save_json_separation_stats(record, "blossom", cutgen->blossom_stats);
+
+    BlossomBenchmark &benchmark = cutgen->blossom_benchmark;
+    if (benchmark.points > 0)
+    {
+        record->save_json_field("blossom_benchmark_points", benchmark.points);
+        record->save_json_field("blossom_benchmark_padberg_rao_found",
+                                benchmark.padberg_rao_found);
+        record->save_json_field("blossom_benchmark_fractional_found",
+                                benchmark.fractional_found);
+        record->save_json_field("blossom_benchmark_padberg_rao_time",
+                                benchmark.padberg_rao_time);
+        record->save_json_field("blossom_benchmark_fractional_time",
+                                benchmark.fractional_time);
+        record->save_json_field("blossom_benchmark_disagreements",
+                                benchmark.disagreements);
+    }
+
+    MaxFlowBenchmark flow_benchmark = cutgen->get_max_flow_benchmark();
+    if (flow_benchmark.pairs > 0)
+    {
+        record->save_json_field("msi_flow_benchmark_pairs", flow_benchmark.pairs);
+        record->save_json_field("msi_flow_benchmark_lemon_found",
+                                flow_benchmark.lemon_violated);
+        record->save_json_field("msi_flow_benchmark_csr_found",
+                                flow_benchmark.csr_violated);
+        record->save_json_field("msi_flow_benchmark_csr_early_exits",
+                                flow_benchmark.csr_early_exits);
+        record->save_json_field("msi_flow_benchmark_lemon_time",
+                                flow_benchmark.lemon_time);
+        record->save_json_field("msi_flow_benchmark_csr_time",
+                                flow_benchmark.csr_time);
+        record->save_json_field("msi_flow_benchmark_disagreements",
+                                flow_benchmark.disagreements);
+    }
+    save_json_separation_stats(record, "msi", cutgen->minimal_separators_stats);
+    save_json_separation_stats(record, "indegree", cutgen->indegree_stats);
+
+    record->save_json_field("rounding_calls", cutgen->rounding_calls);
+    record->save_json_field("rounding_improvements",
+                            cutgen->rounding_improvements);
+    record->save_json_field("repair_calls", cutgen->repair_calls);
+    record->save_json_field("repair_improvements", cutgen->repair_improvements);
+    record->save_json_field("lns_solutions_used", cutgen->lns_solutions_used);
+}
@@ -7,6 +7,7 @@
 #include <limits>
 #include <sys/time.h>
 #include <utility>
+#include <atomic>
 
 #include "gurobi_c++.h"
 
@@ -24,11 +25,12 @@
  */
 
 class WCMCutGenerator;
+class WCMLNS;
 
 class WCMModel
 {
 public:
-    WCMModel(IO*);
+    WCMModel(IO*, GRBEnv* = NULL);
     virtual ~WCMModel();
 
     int solve(bool);
@@ -45,6 +47,12 @@ public:
     long lp_passes;
 
     void set_time_limit(double);
+    bool set_mip_start(const vector<bool> &);
+    void set_objective_upper_bound(double);
+    double objective_upper_bound;
+    void set_lns(WCMLNS*);
+    void set_stop_flag(const std::atomic<bool> *);
+    void terminate();
 
     // further info methods
     double get_mip_runtime();
@@ -54,10 +62,13 @@ public:
     long get_mip_indegree_counter();
     long get_mip_msi_counter();
 
+    void save_json_info(IO*);
+
 protected:
     IO *instance;
 
     GRBEnv *env;
+    bool owns_env;
     GRBModel *model;
     GRBVar *x;
     GRBVar *y;
@@ -72,7 +83,9 @@ protected:
     void fill_solution_vectors();
 
     bool check_solution();
-    void dfs_to_tag_component(long, vector<bool>&);
 };
 
+// gurobi environments for threads solving models concurrently (one each)
+long add_worker_envs(vector<GRBEnv*> &, long);
+
 #endif
@@ -0,0 +1,236 @@
+#include "wcm_reduction.h"
+
+WCMReduction::WCMReduction(IO *instance)
+{
+    this->instance = instance;
+    this->reduced_instance = NULL;
+
+    this->isolated_vertices = 0;
+    this->pendant_nonpositive_vertices = 0;
+    this->pendant_twin_vertices = 0;
+    this->pendant_nonpositive_edges = 0;
+    this->pendant_twin_edges = 0;
+    this->removed_edges = 0;
+    this->reduction_runtime = -1;
+}
+
+WCMReduction::~WCMReduction()
+{
+    delete reduced_instance;
+}
+
+IO *WCMReduction::reduce()
+{
+    /***
+     * Apply the reduction rules exhaustively, in O(n + m) time overall (each
+     * vertex is examined once initially and once after each deletion of one of
+     * its neighbours, in O(1) time thanks to the xor of remaining neighbours).
+     * Returns the reduced instance, owned by this object.
+     */
+
+    Timer reduction_clock;
+
+    const long n = instance->graph->num_vertices;
+    Graph *graph = instance->graph;
+
+    // 1. INITIAL DEGREES AND NEIGHBOURHOOD SUMMARIES
+    removed = vector<bool>(n, false);
+    degree = vector<long>(n, 0);
+    neighbour_xor = vector<long>(n, 0);
+    edge_xor = vector<long>(n, 0);
+    best_pendant = vector<long>(n, -1);
+
+    for (long u = 0; u < n; ++u)
+    {
+        degree[u] = graph->adj_offset[u+1] - graph->adj_offset[u];
+
+        for (long k = graph->adj_offset[u]; k < graph->adj_offset[u+1]; ++k)
+        {
+            neighbour_xor[u] ^= graph->adj_pairs[2*k];
+            edge_xor[u] ^= graph->adj_pairs[2*k + 1];
+        }
+    }
+
+    // 2. APPLY RULES UNTIL NONE IS APPLICABLE
+    worklist.clear();
+    for (long u = n-1; u >= 0; --u)
+        worklist.push_back(u);
+
+    while (!worklist.empty())
+    {
+        long v = worklist.back();
+        worklist.pop_back();
+        examine_vertex(v);
+    }
+
+    // 3. SUBGRAPH INDUCED BY THE REMAINING VERTICES
+    vector<long> vertices;
+    vector<long> local_index = vector<long>(n, -1);
+    for (long u = 0; u < n; ++u)
+    {
+        if (!removed[u])
+        {
+            local_index[u] = vertices.size();
+            vertices.push_back(u);
+        }
+    }
+
+    delete reduced_instance;
+    reduced_instance = instance->induced_subinstance(vertices,
+                                                     local_index,
+                                                     original_edge_index);
+
+    this->removed_edges = graph->num_edges - original_edge_index.size();
+    this->reduction_runtime = reduction_clock.realTime();
+
+    cout << "Reductions: " << n - (long) vertices.size() << " vertices and "
+         << removed_edges << " edges removed in " << reduction_runtime
+         << " s (isolated: " << isolated_vertices
+         << " vertices; nonpositive pendant: "
+         << pendant_nonpositive_vertices << " vertices, "
+         << pendant_nonpositive_edges << " edges; pendant twins: "
+         << pendant_twin_vertices << " vertices, "
+         << pendant_twin_edges << " edges)" << endl;
+
+    return reduced_instance;
+}
+
+long WCMReduction::remove_vertex(long v)
+{
+    /***
+     * Delete v, updating its remaining neighbours (which are examined again).
+     * Returns the number of edges deleted with it.
+     */
+
+    Graph *graph = instance->graph;
+    long edges_removed = 0;
+
+    removed[v] = true;
+
+    for (long k = graph->adj_offset[v]; k < graph->adj_offset[v+1]; ++k)
+    {
+        long x = graph->adj_pairs[2*k];
+
+        if (!removed[x])
+        {
+            degree[x]--;
+            neighbour_xor[x] ^= v;
+            edge_xor[x] ^= graph->adj_pairs[2*k + 1];
+            worklist.push_back(x);
+            ++edges_removed;
+        }
+    }
+
+    degree[v] = 0;
+    return edges_removed;
+}
+
+void WCMReduction::examine_vertex(long v)
+{
+    /// apply the first rule that fits vertex v, if any
+
+    if (removed[v])
+        return;
+
+    // 1. ISOLATED VERTEX
+    if (degree[v] == 0)
+    {
+        ++isolated_vertices;
+        remove_vertex(v);
+        return;
+    }
+
+    if (degree[v] != 1)
+        return;
+
+    const long u = neighbour_xor[v];
+    const double weight = instance->graph->w[edge_xor[v]];
+
+    // 2. PENDANT VERTEX WITH NONPOSITIVE EDGE, AT A VERTEX OF DEGREE AT MOST 2
+    if (weight <= 0 && degree[u] <= 2)
+    {
+        ++pendant_nonpositive_vertices;
+        pendant_nonpositive_edges += remove_vertex(v);
+        return;
+    }
+
+    // 3. PENDANT TWINS: KEEP ONLY THE HEAVIEST PENDANT VERTEX AT u
+    const long other = best_pendant[u];
+
+    if (other >= 0 && other != v && !removed[other] && degree[other] == 1)
+    {
+        const double other_weight = instance->graph->w[edge_xor[other]];
+
+        ++pendant_twin_vertices;
+
+        if (other_weight >= weight)
+        {
+            pendant_twin_edges += remove_vertex(v);
+            return;
+        }
+
+        pendant_twin_edges += remove_vertex(other);
+    }
+
+    best_pendant[u] = v;
+}
+
+vector<bool> WCMReduction::lift_solution(const vector<bool> &reduced_solution)
+{
+    /// solution of the reduced instance, as an edge subset of the original one
+
+    vector<bool> solution = vector<bool>(instance->graph->num_edges, false);
+
+    for (unsigned long idx = 0; idx < reduced_solution.size(); ++idx)
+        if (reduced_solution[idx])
+            solution[original_edge_index[idx]] = true;
+
+    return solution;
+}
+
+bool WCMReduction::restrict_solution(const vector<bool> &solution,
+                                     vector<bool> &reduced_solution)
+{
+    /***
+     * Edge subset of the original instance (e.g. a MIP start) in the reduced
+     * one. Returns false if it uses an edge that was removed.
+     */
+
+    long num_edges_kept = 0;
+    long num_edges_in_solution = 0;
+
+    reduced_solution = vector<bool>(original_edge_index.size(), false);
+
+    for (unsigned long idx = 0; idx < original_edge_index.size(); ++idx)
+    {
+        if (solution[original_edge_index[idx]])
+        {
+            reduced_solution[idx] = true;
+            ++num_edges_kept;
+        }
+    }
+
+    for (long e = 0; e < instance->graph->num_edges; ++e)
+        if (solution[e])
+            ++num_edges_in_solution;
+
+    return (num_edges_kept == num_edges_in_solution);
+}
+
+void WCMReduction::save_json_info(IO *record)
+{
+    /// save reduction info in the json record
+
+    record->save_json_field("reduced_num_vertices",
+                            reduced_instance->graph->num_vertices);
+    record->save_json_field("reduced_num_edges",
+                            reduced_instance->graph->num_edges);
+    record->save_json_field("reduction_isolated", isolated_vertices);
+    record->save_json_field("reduction_pendant_nonpositive",
+                            pendant_nonpositive_vertices);
+    record->save_json_field("reduction_pendant_twins", pendant_twin_vertices);
+    record->save_json_field("reduction_pendant_nonpositive_edges",
+                            pendant_nonpositive_edges);
+    record->save_json_field("reduction_pendant_twins_edges", pendant_twin_edges);
+    record->save_json_field("reduction_runtime", reduction_runtime);
+}
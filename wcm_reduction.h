@@ -0,0 +1,68 @@
+#ifndef _WCM_REDUCTION_H_
+#define _WCM_REDUCTION_H_
+
+#include <iostream>
+#include <vector>
+
+#include "io.h"
+
+/***
+ * \file wcm_reduction.h
+ *
+ * Module for reducing an instance before model construction, by deleting
+ * vertices not covered by at least one optimal connected matching. The reduced
+ * instance is the subgraph induced by the remaining vertices, and solutions of
+ * it are lifted back to the original graph through an edge map. Rules:
+ * - isolated vertices
+ * - a pendant vertex v whose edge uv has nonpositive weight, if deg(u) <= 2
+ * (if uv is in a solution, u is at most a connector between v and its other
+ * neighbour, so dropping uv keeps the rest connected; peels paths and chains)
+ * - pendant twins: among pendant vertices adjacent to the same u, at most one
+ * is covered, and only the heaviest edge needs to be kept
+ *
+ * \author Phillippe Samer <samer@uib.no>
+ * \date 17.10.2026
+ */
+
+class WCMReduction
+{
+public:
+    WCMReduction(IO*);
+    virtual ~WCMReduction();
+
+    IO *reduce();
+    IO *reduced_instance;
+
+    vector<bool> lift_solution(const vector<bool> &);
+    bool restrict_solution(const vector<bool> &, vector<bool> &);
+
+    // number of vertices and edges deleted by each rule (and edges overall;
+    // isolated vertices take no edges with them)
+    long isolated_vertices;
+    long pendant_nonpositive_vertices;
+    long pendant_twin_vertices;
+    long pendant_nonpositive_edges;
+    long pendant_twin_edges;
+    long removed_edges;
+    double reduction_runtime;
+
+    void save_json_info(IO*);
+
+protected:
+    IO *instance;
+
+    vector<long> original_edge_index;   // of each edge in the reduced instance
+
+    // current graph, after deletions so far
+    vector<bool> removed;
+    vector<long> degree;
+    vector<long> neighbour_xor;      // if degree[v] == 1, the only neighbour
+    vector<long> edge_xor;           // if degree[v] == 1, the only edge
+    vector<long> best_pendant;       // heaviest pendant vertex found at u
+    vector<long> worklist;
+
+    long remove_vertex(long);
+    void examine_vertex(long);
+};
+
+#endif